@@ -0,0 +1,162 @@
+// Throughput of state hashing: full rehash of every box (the solver's hash before
+// Zobrist hashing) against incremental Zobrist update in the successor loop.
+
+#include <cstdio>
+#include <queue>
+#include <unordered_set>
+
+#include "bench_util.h"
+#include "soko/util.h"
+#include "soko/zobrist.h"
+
+using namespace soko;
+
+namespace
+{
+
+const size_t g_maxTransitions = 100000;
+
+size_t fullHash(const CompactState &s) noexcept
+{
+  std::hash<size_t> hash;
+  const size_t ci = 21589;
+  size_t result = 0;
+  for (size_t i = 0; i < s.boxCount(); ++i)
+  {
+    result += (i + ci) * hash(s.boxes()[i]);
+  }
+  return result ^ (ci * hash(s.unit()));
+}
+
+struct FullHash
+{
+  size_t operator()(const CompactState &s) const noexcept { return fullHash(s); }
+};
+
+CellIndex normalizedUnit(const Mat<bool> &unitMap)
+{
+  auto it = std::find(unitMap.begin(), unitMap.end(), true);
+  return static_cast<CellIndex>(it - unitMap.begin());
+}
+
+struct Transition
+{
+  size_t parent;
+  CellIndex boxFrom;
+  CellIndex boxTo;
+  CompactState child;
+};
+
+// Breadth-first enumeration of pushes, starting from the level's initial state
+std::vector<Transition> collectTransitions(const Map &level, std::vector<CompactState> &states)
+{
+  MapState initial;
+  const MapStatic map = mapToMapStatic(level, &initial.boxes, &initial.unit);
+  const size_t cols = map.cols();
+  initial.unit = toPos(normalizedUnit(drawUnitMap(map, initial.unit, initial.boxes)), cols);
+
+  std::vector<Transition> result;
+  std::unordered_set<CompactState, FullHash> seen;
+  states = {CompactState(initial, cols)};
+  seen.insert(states.front());
+  for (size_t current = 0; current < states.size() && result.size() < g_maxTransitions; ++current)
+  {
+    MapState state = states[current].toMapState(cols);
+    auto unitMap = drawUnitMap(map, state.unit, state.boxes);
+    for (size_t i = 0; i < state.boxes.size(); ++i)
+    {
+      for (auto m : {Move::Left, Move::Up, Move::Right, Move::Down})
+      {
+        Pos box = state.boxes[i];
+        Pos from = box - m;
+        Pos to = box + m;
+        if (!unitMap.contains(from) || !unitMap.at(from) || !safeIsFree(map, to, state.boxes))
+        {
+          continue;
+        }
+        CompactState child = states[current];
+        child.moveBox(i, toCellIndex(to, cols));
+        MapState next = child.toMapState(cols);
+        child.setUnit(normalizedUnit(drawUnitMap(map, box, next.boxes)));
+        result.push_back({current, toCellIndex(box, cols), toCellIndex(to, cols), child});
+        if (seen.insert(child).second)
+        {
+          states.push_back(child);
+        }
+      }
+    }
+  }
+  return result;
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+  auto levels = bench::loadLevels(argc, argv);
+  std::printf("%-50s %10s %12s %12s %8s %10s\n", "level", "states", "full ns", "zobrist ns",
+              "speedup", "collisions");
+
+  double totalFull = 0;
+  double totalZobrist = 0;
+  size_t totalTransitions = 0;
+  for (auto &level : levels)
+  {
+    std::vector<CompactState> states;
+    auto transitions = collectTransitions(level.map, states);
+    if (transitions.empty())
+    {
+      continue;
+    }
+    ZobristKeys keys(level.map.rows() * level.map.cols());
+    // parents carry their hashes, as solver nodes do
+    std::vector<StateHash> parentHashes;
+    for (auto &s : states)
+    {
+      parentHashes.push_back(keys.hash(s));
+    }
+
+    volatile size_t sink = 0;
+    double full = bench::measure([&] {
+      size_t acc = 0;
+      for (auto &t : transitions)
+      {
+        acc ^= fullHash(t.child);
+      }
+      sink = acc;
+    });
+    double zobrist = bench::measure([&] {
+      size_t acc = 0;
+      for (auto &t : transitions)
+      {
+        StateHash h = keys.moveBox(parentHashes[t.parent], t.boxFrom, t.boxTo);
+        acc ^= keys.moveUnit(h, states[t.parent].unit(), t.child.unit());
+      }
+      sink = acc;
+    });
+
+    // collisions among distinct states
+    std::unordered_set<StateHash> zobristHashes;
+    std::unordered_set<size_t> fullHashes;
+    for (auto &s : states)
+    {
+      zobristHashes.insert(keys.hash(s));
+      fullHashes.insert(fullHash(s));
+    }
+
+    size_t n = transitions.size();
+    std::printf("%-50s %10zu %12.2f %12.2f %8.2f %4zu/%-5zu\n", level.name.substr(0, 50).c_str(),
+                n, full / n * 1e9, zobrist / n * 1e9, full / zobrist,
+                states.size() - zobristHashes.size(), states.size() - fullHashes.size());
+    totalFull += full;
+    totalZobrist += zobrist;
+    totalTransitions += n;
+  }
+  if (totalTransitions != 0)
+  {
+    std::printf("%-50s %10zu %12.2f %12.2f %8.2f\n", "total", totalTransitions,
+                totalFull / totalTransitions * 1e9, totalZobrist / totalTransitions * 1e9,
+                totalFull / totalZobrist);
+  }
+  return 0;
+}
@@ -0,0 +1,83 @@
+// Cost of the Hungarian heuristic on states met during a search: the full solve of
+// operator(), evaluation by the incremental assignment, that the solver uses, and the cheap
+// lower bound. Sum of the heuristic values is printed to compare the results of builds.
+// Pattern database lookups are measured too, with the states, where they exceed Hungarian.
+
+#include <cstdio>
+
+#include "bench_util.h"
+#include "soko/heuristic.h"
+#include "soko/pattern_database.h"
+#include "soko/util.h"
+
+using namespace soko;
+
+namespace
+{
+
+const size_t g_maxStates = 20000;
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+  auto levels = bench::loadLevels(argc, argv);
+  std::printf("%-50s %8s %12s %12s %12s %14s %12s %10s\n", "level", "states", "full ns",
+              "evaluate ns", "bound ns", "sum h", "pdb ns", "pdb > h");
+
+  double total[4] = {};
+  size_t totalGreater = 0;
+  size_t totalStates = 0;
+  for (auto &level : levels)
+  {
+    MapState initial;
+    const MapStatic map = mapToMapStatic(level.map, &initial.boxes, &initial.unit);
+    std::vector<MapState> states;
+    for (auto &s : bench::collectStates(map, initial, g_maxStates))
+    {
+      states.push_back(s.toMapState(map.cols()));
+    }
+    auto heuristic = Heuristic::create(HeuristicType::HungarianTaxicab);
+    heuristic->init(level.map);
+
+    size_t sum = 0;
+    auto run = [&](auto &&evaluate) {
+      return bench::measure([&] {
+        sum = 0;
+        for (size_t i = 0; i < states.size(); ++i)
+        {
+          const HeuristicValue h = evaluate(states[i], i);
+          sum += h == g_unsolvable ? 0 : h;
+        }
+      });
+    };
+    const double full = run([&](const MapState &s, size_t) { return (*heuristic)(s); });
+    const size_t fullSum = sum;
+    const double evaluate = run([&](const MapState &s, size_t i) { return heuristic->evaluate(s, i); });
+    const double bound = run([&](const MapState &s, size_t) { return heuristic->lowerBound(s); });
+
+    const PatternDatabase patterns(map, PatternDatabase::g_maxGroupSize);
+    const double pdb = run([&](const MapState &s, size_t) { return patterns.evaluate(s.boxes); });
+    size_t greater = 0;
+    for (auto &s : states)
+    {
+      const HeuristicValue h = (*heuristic)(s);
+      greater += h != g_unsolvable && patterns.evaluate(s.boxes) > h;
+    }
+
+    const size_t n = states.size();
+    std::printf("%-50s %8zu %12.1f %12.1f %12.1f %14zu %12.1f %10zu\n",
+                level.name.substr(0, 50).c_str(), n, full / n * 1e9, evaluate / n * 1e9,
+                bound / n * 1e9, fullSum, pdb / n * 1e9, greater);
+    total[0] += full;
+    total[1] += evaluate;
+    total[2] += bound;
+    total[3] += pdb;
+    totalGreater += greater;
+    totalStates += n;
+  }
+  std::printf("\n%-50s %8zu %12.1f %12.1f %12.1f %14s %12.1f %10zu\n", "average", totalStates,
+              total[0] / totalStates * 1e9, total[1] / totalStates * 1e9,
+              total[2] / totalStates * 1e9, "", total[3] / totalStates * 1e9, totalGreater);
+  return 0;
+}
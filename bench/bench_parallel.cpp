@@ -0,0 +1,125 @@
+// Speedup of hash distributed A* with the number of threads. Every level is solved with each
+// thread count; time is compared with the single thread run. Example:
+//   bench_parallel --threads=1,2,4,8 --max-nodes=1000000 Original01
+
+#include <cstdio>
+#include <iostream>
+#include <thread>
+
+#include "bench_util.h"
+#include "soko/solver.h"
+
+using namespace soko;
+
+namespace
+{
+
+struct Options
+{
+  std::vector<size_t> threads = {1, 2, 4, 8};
+  size_t maxNodes = 200000;
+};
+
+std::vector<size_t> parseList(const std::string &s)
+{
+  std::vector<size_t> result;
+  size_t start = 0;
+  while (start <= s.size())
+  {
+    size_t end = s.find(',', start);
+    result.push_back(std::stoul(s.substr(start, end - start)));
+    if (end == std::string::npos)
+    {
+      break;
+    }
+    start = end + 1;
+  }
+  return result;
+}
+
+Options parseOptions(int argc, char **argv)
+{
+  Options result;
+  for (int i = 1; i < argc; ++i)
+  {
+    std::string arg = argv[i];
+    if (arg.compare(0, 10, "--threads=") == 0)
+    {
+      result.threads = parseList(arg.substr(10));
+    }
+    else if (arg.compare(0, 12, "--max-nodes=") == 0)
+    {
+      result.maxNodes = std::stoul(arg.substr(12));
+    }
+    else if (arg.compare(0, 1, "-") == 0)
+    {
+      throw std::logic_error("Unknown option: " + arg);
+    }
+  }
+  if (result.threads.empty() || result.threads.front() == 0)
+  {
+    throw std::logic_error("Thread counts should be positive");
+  }
+  return result;
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+  Options options;
+  try
+  {
+    options = parseOptions(argc, argv);
+  }
+  catch (const std::exception &e)
+  {
+    std::cerr << e.what() << std::endl;
+    return 1;
+  }
+  auto levels = bench::loadLevels(argc, argv);
+
+  std::printf("hardware threads: %u\n", std::thread::hardware_concurrency());
+  std::printf("%-40s %7s %6s %6s %10s %10s %10s %9s %8s\n", "level", "threads", "solved",
+              "pushes", "nodes", "expanded", "messages", "time s", "speedup");
+  std::vector<double> totalTime(options.threads.size(), 0);
+  for (auto &level : levels)
+  {
+    double baseTime = 0;
+    for (size_t i = 0; i < options.threads.size(); ++i)
+    {
+      Solver solver;
+      solver.setHeuristic(Heuristic::create(HeuristicType::HungarianTaxicab));
+      SolverConfig config;
+      config.algorithm = SearchAlgorithm::HdaStar;
+      config.threads = options.threads[i];
+      config.maxNodes = options.maxNodes;
+      solver.setConfig(config);
+
+      bench::Stopwatch watch;
+      solver.solve(level.map);
+      double time = watch.seconds();
+      if (i == 0)
+      {
+        baseTime = time;
+      }
+      totalTime[i] += time;
+
+      bool solved = solver.solved() == SolveState::Solved;
+      auto &stats = solver.statistics();
+      std::printf("%-40s %7zu %6s %6zu %10zu %10zu %10zu %9.3f %8.2f\n",
+                  level.name.substr(0, 40).c_str(), options.threads[i], solved ? "yes" : "no",
+                  solved ? solver.boxMovements() : 0, stats.nodes, stats.expanded, stats.messages,
+                  time, baseTime / time);
+      std::fflush(stdout);
+    }
+  }
+
+  std::printf("\n%7s %9s %8s\n", "threads", "time s", "speedup");
+  for (size_t i = 0; i < options.threads.size(); ++i)
+  {
+    std::printf("%7zu %9.3f %8.2f\n", options.threads[i], totalTime[i],
+                totalTime.front() / totalTime[i]);
+  }
+  return 0;
+}
@@ -0,0 +1,91 @@
+// Throughput of the unit area flood fill on states met during a search: drawUnitMap
+// (queue-based BFS), the stamped cell fill used by the solver and bitboard fill, scalar
+// and AVX2. Bitboard results are checked against the cell fill.
+
+#include <cstdio>
+
+#include "bench_util.h"
+#include "soko/bitboard_reachability.h"
+#include "soko/reachability.h"
+#include "soko/util.h"
+
+using namespace soko;
+
+namespace
+{
+
+const size_t g_maxStates = 20000;
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+  auto levels = bench::loadLevels(argc, argv);
+  std::printf("%-50s %8s %10s %10s %10s %10s %10s\n", "level", "states", "unitMap ns", "cells ns",
+              "bits ns", "avx2 ns", "mismatches");
+
+  for (auto &level : levels)
+  {
+    MapState initial;
+    const MapStatic map = mapToMapStatic(level.map, &initial.boxes, &initial.unit);
+    if (!BitboardReachability::supports(map))
+    {
+      continue;
+    }
+    const size_t cols = map.cols();
+    auto states = bench::collectStates(map, initial, g_maxStates);
+    std::vector<MapState> mapStates;
+    for (auto &s : states)
+    {
+      mapStates.push_back(s.toMapState(cols));
+    }
+
+    volatile size_t sink = 0;
+    double unitMap = bench::measure([&] {
+      size_t acc = 0;
+      for (auto &s : mapStates)
+      {
+        acc += drawUnitMap(map, s.unit, s.boxes).at(s.unit);
+      }
+      sink = acc;
+    });
+
+    Reachability cells(map);
+    std::vector<CellIndex> expected;
+    double cellFill = bench::measure([&] {
+      expected.clear();
+      for (auto &s : states)
+      {
+        cells.setBoxes(s.boxes(), s.boxCount());
+        expected.push_back(cells.fill(s.unit()));
+      }
+    });
+
+    BitboardReachability bits(map);
+    size_t mismatches = 0;
+    auto bitFill = [&] {
+      mismatches = 0;
+      for (size_t i = 0; i < states.size(); ++i)
+      {
+        bits.setBoxes(states[i].boxes(), states[i].boxCount());
+        mismatches += bits.fill(states[i].unit()) != expected[i];
+      }
+    };
+    bits.setAvx2(false);
+    double scalar = bench::measure(bitFill);
+    size_t totalMismatches = mismatches;
+    double avx2 = 0;
+    if (BitboardReachability::avx2Supported())
+    {
+      bits.setAvx2(true);
+      avx2 = bench::measure(bitFill);
+      totalMismatches += mismatches;
+    }
+
+    size_t n = states.size();
+    std::printf("%-50s %8zu %10.1f %10.1f %10.1f %10.1f %10zu\n", level.name.substr(0, 50).c_str(),
+                n, unitMap / n * 1e9, cellFill / n * 1e9, scalar / n * 1e9, avx2 / n * 1e9,
+                totalMismatches);
+  }
+  return 0;
+}
@@ -0,0 +1,236 @@
+// Runs the solver on the bundled levels with one or several configurations.
+//
+// Options have the form --name=value; comma separated values produce a configuration for each
+// value (all combinations, if several options have lists). Example:
+//   bench_solver --queue=bucket,heap --reopen=on,off --lazy=on,off --max-nodes=100000 Original01
+//   bench_solver --algorithm=astar,ida --table-mb=16 Original01
+//   bench_solver --algorithm=hda --threads=1,2,4 Original01
+//   bench_solver --eval-threads=0,1,4 --batch=1,8 Original01
+//   bench_solver --algorithm=astar,bidir Original01
+//   bench_solver --algorithm=ara --weight=5 --weight-step=0,1 Original01
+//   bench_solver --optimality=pushes,moves Original01
+//   bench_solver --tunnels=off,on Original01
+//   bench_solver --partial=off,on --optimality=none,pushes Original01
+//   bench_solver --algorithm=greedy,beam --beam-width=100,10000 Original01
+//   bench_solver --algorithm=astar,external --scratch=/tmp --run-mb=1,64 Original01
+//   bench_solver --heuristic=taxicab,pdb --pdb-cache=/tmp Original01
+//   bench_solver --heuristic=push,taxicab,penalties Original01
+
+#include <cstdio>
+#include <functional>
+#include <iostream>
+#include <map>
+
+#include "bench_util.h"
+#include "soko/solver.h"
+
+using namespace soko;
+
+namespace
+{
+
+struct Variant
+{
+  std::string label;
+  SolverConfig config;
+  HeuristicType heuristic = HeuristicType::HungarianTaxicab;
+  std::string patternCache;
+};
+
+template<typename T>
+T parseValue(const std::string &value, const std::map<std::string, T> &values)
+{
+  auto it = values.find(value);
+  if (it == values.end())
+  {
+    throw std::logic_error("Unknown value: " + value);
+  }
+  return it->second;
+}
+
+using Setter = std::function<void(Variant &, const std::string &)>;
+
+const std::map<std::string, Setter> g_options = {
+    {"optimality",
+     [](Variant &v, const std::string &s) {
+       v.config.optimality = parseValue<Optimality>(
+           s, {{"none", Optimality::None},
+               {"pushes", Optimality::Pushes},
+               {"moves", Optimality::Moves}});
+     }},
+    {"algorithm",
+     [](Variant &v, const std::string &s) {
+       v.config.algorithm = parseValue<SearchAlgorithm>(
+           s, {{"astar", SearchAlgorithm::AStar},
+               {"ida", SearchAlgorithm::IdaStar},
+               {"hda", SearchAlgorithm::HdaStar},
+               {"bidir", SearchAlgorithm::Bidirectional},
+               {"ara", SearchAlgorithm::AraStar},
+               {"greedy", SearchAlgorithm::Greedy},
+               {"beam", SearchAlgorithm::Beam},
+               {"external", SearchAlgorithm::ExternalAStar}});
+     }},
+    {"threads", [](Variant &v, const std::string &s) { v.config.threads = std::stoul(s); }},
+    {"eval-threads",
+     [](Variant &v, const std::string &s) { v.config.evaluationThreads = std::stoul(s); }},
+    {"batch", [](Variant &v, const std::string &s) { v.config.batchNodes = std::stoul(s); }},
+    {"beam-width", [](Variant &v, const std::string &s) { v.config.beamWidth = std::stoul(s); }},
+    {"scratch", [](Variant &v, const std::string &s) { v.config.scratchDirectory = s; }},
+    {"run-mb", [](Variant &v, const std::string &s) { v.config.runBytes = std::stoul(s) << 20; }},
+    {"weight", [](Variant &v, const std::string &s) { v.config.weight = std::stod(s); }},
+    {"weight-step", [](Variant &v, const std::string &s) { v.config.weightStep = std::stod(s); }},
+    {"table-mb",
+     [](Variant &v, const std::string &s) { v.config.tableBytes = std::stoul(s) << 20; }},
+    {"queue",
+     [](Variant &v, const std::string &s) {
+       v.config.openList = parseValue<OpenListType>(
+           s, {{"bucket", OpenListType::BucketQueue}, {"heap", OpenListType::BinaryHeap}});
+     }},
+    {"max-nodes", [](Variant &v, const std::string &s) { v.config.maxNodes = std::stoul(s); }},
+    {"reopen",
+     [](Variant &v, const std::string &s) {
+       v.config.reopenNodes = parseValue<bool>(s, {{"on", true}, {"off", false}});
+     }},
+    {"tunnels",
+     [](Variant &v, const std::string &s) {
+       v.config.tunnelMacros = parseValue<bool>(s, {{"on", true}, {"off", false}});
+     }},
+    {"lazy",
+     [](Variant &v, const std::string &s) {
+       v.config.lazyHeuristic = parseValue<bool>(s, {{"on", true}, {"off", false}});
+     }},
+    {"partial",
+     [](Variant &v, const std::string &s) {
+       v.config.partialExpansion = parseValue<bool>(s, {{"on", true}, {"off", false}});
+     }},
+    {"heuristic",
+     [](Variant &v, const std::string &s) {
+       v.heuristic = parseValue<HeuristicType>(
+           s, {{"taxicab", HeuristicType::HungarianTaxicab},
+               {"push", HeuristicType::HungarianTaxicabPush},
+               {"pdb", HeuristicType::HungarianPatternDatabase},
+               {"penalties", HeuristicType::HungarianPenalties}});
+     }},
+    {"pdb-cache", [](Variant &v, const std::string &s) { v.patternCache = s; }},
+};
+
+std::vector<std::string> split(const std::string &s)
+{
+  std::vector<std::string> result;
+  size_t start = 0;
+  while (true)
+  {
+    size_t end = s.find(',', start);
+    result.push_back(s.substr(start, end - start));
+    if (end == std::string::npos)
+    {
+      return result;
+    }
+    start = end + 1;
+  }
+}
+
+std::vector<Variant> parseVariants(int argc, char **argv)
+{
+  Variant base;
+  base.config.maxNodes = 200000;
+  std::vector<Variant> result = {base};
+  for (int i = 1; i < argc; ++i)
+  {
+    std::string arg = argv[i];
+    if (arg.size() < 2 || arg.compare(0, 2, "--") != 0)
+    {
+      continue;
+    }
+    auto eq = arg.find('=');
+    std::string name = arg.substr(2, eq - 2);
+    auto option = g_options.find(name);
+    if (eq == std::string::npos || option == g_options.end())
+    {
+      throw std::logic_error("Unknown option: " + arg);
+    }
+    std::vector<Variant> expanded;
+    for (auto &value : split(arg.substr(eq + 1)))
+    {
+      for (auto variant : result)
+      {
+        option->second(variant, value);
+        variant.label += (variant.label.empty() ? "" : " ") + name + "=" + value;
+        expanded.push_back(variant);
+      }
+    }
+    result = std::move(expanded);
+  }
+  return result;
+}
+
+struct Total
+{
+  size_t solved = 0;
+  size_t nodes = 0;
+  size_t expanded = 0;
+  size_t heuristicCalls = 0;
+  double initTime = 0;
+  double time = 0;
+};
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+  std::vector<Variant> variants;
+  try
+  {
+    variants = parseVariants(argc, argv);
+  }
+  catch (const std::exception &e)
+  {
+    std::cerr << e.what() << std::endl;
+    return 1;
+  }
+  auto levels = bench::loadLevels(argc, argv);
+
+  std::printf("%-40s %-30s %6s %6s %6s %10s %10s %10s %9s %9s %9s\n", "level", "config",
+              "solved", "pushes", "moves", "nodes", "expanded", "h calls", "h init s", "time s",
+              "kexp/s");
+  std::vector<Total> totals(variants.size());
+  for (auto &level : levels)
+  {
+    for (size_t i = 0; i < variants.size(); ++i)
+    {
+      auto &variant = variants[i];
+      Solver solver;
+      solver.setHeuristic(Heuristic::create(variant.heuristic, variant.patternCache));
+      solver.setConfig(variant.config);
+
+      bench::Stopwatch watch;
+      solver.solve(level.map);
+      double time = watch.seconds();
+
+      bool solved = solver.solved() == SolveState::Solved;
+      auto &stats = solver.statistics();
+      std::printf("%-40s %-30s %6s %6zu %6zu %10zu %10zu %10zu %9.3f %9.3f %9.1f\n",
+                  level.name.substr(0, 40).c_str(), variant.label.c_str(), solved ? "yes" : "no",
+                  solved ? solver.boxMovements() : 0, solved ? solver.result().size() : 0,
+                  stats.nodes, stats.expanded, stats.heuristicCalls, stats.heuristicInitSeconds,
+                  time, stats.expanded / time / 1000);
+      std::fflush(stdout);
+      totals[i].solved += solved;
+      totals[i].nodes += stats.nodes;
+      totals[i].expanded += stats.expanded;
+      totals[i].heuristicCalls += stats.heuristicCalls;
+      totals[i].initTime += stats.heuristicInitSeconds;
+      totals[i].time += time;
+    }
+  }
+
+  std::printf("\n%-30s %8s %12s %12s %12s %9s %9s\n", "config", "solved", "nodes", "expanded",
+              "h calls", "h init s", "time s");
+  for (size_t i = 0; i < variants.size(); ++i)
+  {
+    std::printf("%-30s %4zu/%-3zu %12zu %12zu %12zu %9.3f %9.3f\n", variants[i].label.c_str(),
+                totals[i].solved, levels.size(), totals[i].nodes, totals[i].expanded,
+                totals[i].heuristicCalls, totals[i].initTime, totals[i].time);
+  }
+  return 0;
+}
@@ -0,0 +1,111 @@
+#include "bench_util.h"
+#include "interface/util.h"
+#include "soko/reachability.h"
+#include "soko/zobrist.h"
+
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <unordered_set>
+
+namespace soko
+{
+
+namespace bench
+{
+
+namespace
+{
+
+bool matches(const std::string &name, const std::vector<std::string> &filters)
+{
+  return filters.empty() || std::any_of(filters.begin(), filters.end(), [&name](auto &f) {
+           return name.find(f) != std::string::npos;
+         });
+}
+
+} // namespace
+
+std::vector<Level> loadLevels(int argc, char **argv)
+{
+  std::vector<std::string> filters;
+  for (int i = 1; i < argc; ++i)
+  {
+    if (argv[i][0] != '-')
+    {
+      filters.push_back(argv[i]);
+    }
+  }
+
+  std::vector<std::filesystem::path> files;
+  for (auto &entry : std::filesystem::directory_iterator(SOKO_LEVELS_DIR))
+  {
+    if (entry.path().extension() == ".txt")
+    {
+      files.push_back(entry.path());
+    }
+  }
+  std::sort(files.begin(), files.end());
+
+  std::vector<Level> result;
+  for (auto &file : files)
+  {
+    std::ifstream is(file);
+    try
+    {
+      for (auto &level : parseFromFile(is))
+      {
+        std::string name = file.stem().string() + "/" + level.first;
+        if (matches(name, filters))
+        {
+          result.push_back({std::move(name), std::move(level.second)});
+        }
+      }
+    }
+    catch (const std::exception &e)
+    {
+      std::cerr << "Skipping " << file << ": " << e.what() << std::endl;
+    }
+  }
+  return result;
+}
+
+std::vector<CompactState> collectStates(const MapStatic &map, const MapState &initial,
+                                        size_t maxStates)
+{
+  Reachability reachability(map);
+  ZobristKeys keys(map.rows() * map.cols());
+  std::vector<CompactState> result = {CompactState(initial, map.cols())};
+  std::unordered_set<StateHash> seen = {keys.hash(result.front())};
+  for (size_t current = 0; current < result.size() && result.size() < maxStates; ++current)
+  {
+    const CompactState state = result[current];
+    reachability.setBoxes(state.boxes(), state.boxCount());
+    reachability.fill(state.unit());
+    for (size_t i = 0; i < state.boxCount(); ++i)
+    {
+      for (auto m : {Move::Left, Move::Up, Move::Right, Move::Down})
+      {
+        CellIndex box = state.boxes()[i];
+        CellIndex from = reachability.neighbour(box, reverse(m));
+        CellIndex to = reachability.neighbour(box, m);
+        if (from == g_noCell || !reachability.isReachable(from) || !reachability.isFree(to))
+        {
+          continue;
+        }
+        CompactState child = state;
+        child.moveBox(i, to);
+        child.setUnit(box);
+        if (seen.insert(keys.hash(child)).second)
+        {
+          result.push_back(child);
+        }
+      }
+    }
+  }
+  return result;
+}
+
+} // namespace bench
+
+} // namespace soko
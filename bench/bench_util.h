@@ -0,0 +1,63 @@
+#pragma once
+
+#include <chrono>
+#include <string>
+#include <vector>
+
+#include "soko/compact_state.h"
+#include "soko/map.h"
+
+namespace soko
+{
+
+namespace bench
+{
+
+struct Level
+{
+  // "<collection>/<level name>"
+  std::string name;
+  Map map;
+};
+
+// Reads all level collections from the levels directory.
+// Non-option arguments are used as filters: level is taken if its name contains any of them.
+std::vector<Level> loadLevels(int argc, char **argv);
+
+// Breadth-first enumeration of up to `maxStates` states, starting from the level's initial state
+std::vector<CompactState> collectStates(const MapStatic &map, const MapState &initial,
+                                        size_t maxStates);
+
+class Stopwatch {
+public:
+  Stopwatch()
+    : m_start(std::chrono::steady_clock::now())
+  {}
+
+  double seconds() const
+  {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - m_start).count();
+  }
+
+private:
+  std::chrono::steady_clock::time_point m_start;
+};
+
+// Best time of several runs
+template<typename Fn>
+double measure(Fn &&fn, size_t runs = 5)
+{
+  double best = 0;
+  for (size_t i = 0; i < runs; ++i)
+  {
+    Stopwatch watch;
+    fn();
+    double time = watch.seconds();
+    best = i == 0 ? time : std::min(best, time);
+  }
+  return best;
+}
+
+} // namespace bench
+
+} // namespace soko
@@ -2,7 +2,7 @@
 #include "interface/scene.h"
 #include "interface/util.h"
 #include "interface/scene_label.h"
-#include "soko/util.h" // g_inf
+#include "soko/util.h"
 #include <QDebug>
 #include <QThread>
 #include <QApplication>
@@ -251,7 +251,7 @@ QString MainWindow::infoText()
   QString resultStr;
   resultStr += QString("Steps: %1\n").arg(m_scene->stepCounter());
   resultStr += QString("Box Moves: %1\n").arg(m_scene->boxMovements());
-  QString heuristic = m_scene->heuristic() == soko::g_inf ? QString::fromLocal8Bit("INF") :
+  QString heuristic = m_scene->heuristic() == soko::g_unsolvable ? QString::fromLocal8Bit("INF") :
                                                             QString::number(m_scene->heuristic());
   resultStr += QString("Heuristic: %1\n").arg(heuristic);
 
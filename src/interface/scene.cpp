@@ -295,7 +295,7 @@ void Scene::calculateInfoHeuristics()
   bool isSolvable =
       std::all_of(state.boxes.begin(), state.boxes.end(),
                   [this, &state](soko::Pos p) { return m_solvabilityMap->isValid(p, state); });
-  m_heuristic = isSolvable ? calculateHeuristic(m_map->map(), *m_heuristicFn) : soko::g_inf;
+  m_heuristic = isSolvable ? calculateHeuristic(m_map->map(), *m_heuristicFn) : soko::g_unsolvable;
 }
 
 Box *Scene::boxAt(QPointF pt)
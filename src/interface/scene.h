@@ -29,7 +29,7 @@ public:
 
   size_t stepCounter() const { return m_stepCounter; }
   size_t boxMovements() const { return m_boxMovements; }
-  size_t heuristic() const { return m_heuristic; }
+  soko::HeuristicValue heuristic() const { return m_heuristic; }
 
   const soko::Map *map() const noexcept { return m_map == nullptr ? nullptr : &m_map->map(); }
 
@@ -68,5 +68,5 @@ private:
   std::unique_ptr<soko::SolvabilityMap> m_solvabilityMap;
   size_t m_stepCounter = 0;
   size_t m_boxMovements = 0;
-  size_t m_heuristic = 0;
+  soko::HeuristicValue m_heuristic = 0;
 };
@@ -426,7 +426,8 @@ std::vector<std::pair<std::string, soko::Map>> parseFromFile(std::istream &is)
   return result;
 }
 
-size_t calculateHeuristic(const soko::Map &original, const soko::Heuristic &initedHeuristic)
+soko::HeuristicValue calculateHeuristic(const soko::Map &original,
+                                        const soko::Heuristic &initedHeuristic)
 {
   soko::MapState state;
   state.boxes = soko::getBoxes(original);
@@ -0,0 +1,222 @@
+#include "soko/ara_star.h"
+
+#include <algorithm>
+#include <functional>
+
+namespace soko
+{
+
+AraStar::AraStar(SearchSpace &space, const Heuristic &heuristic, const SolverConfig &config,
+                 SolverStatistics &statistics)
+  : m_space(space)
+  , m_heuristic(heuristic)
+  , m_config(config)
+  , m_statistics(statistics)
+  , m_weight(std::max(config.weight, 1.))
+{
+  m_nodes.reset(space.root().cellCount());
+}
+
+bool AraStar::solve(const SolutionCallback &onSolution)
+{
+  const NodeId root = m_nodes.allocate(g_noNode, m_space.rootHash(), m_space.root().cells());
+  m_closedSet.findOrInsert(
+      m_space.rootHash(), [](NodeId) { return false; }, [root]() { return root; });
+  ++m_statistics.heuristicCalls;
+  m_h.push_back(m_heuristic.evaluate(m_space.initialState(), root));
+  m_expandedIn.push_back(0);
+  m_isInconsistent.push_back(false);
+  m_closed.push_back(false);
+  if (m_h[root] == g_unsolvable)
+  {
+    return false;
+  }
+  if (m_h[root] == 0)
+  {
+    m_bestG = 0;
+    m_goal = root;
+  }
+  else
+  {
+    push(root);
+    pushBound(root);
+  }
+
+  size_t publishedG = g_inf;
+  while (true)
+  {
+    improvePath();
+    if (m_goal == g_noNode)
+    {
+      // no solution or the node limit is reached
+      break;
+    }
+    const size_t minF = minOpenF();
+    double bound = minF >= m_bestG ? 1. : std::min(m_weight, static_cast<double>(m_bestG) / minF);
+    if (publishedG != g_inf)
+    {
+      // the previous bound holds for the solution too: it's not longer than the previous one
+      bound = std::min(bound, m_statistics.suboptimality);
+    }
+    m_statistics.suboptimality = bound;
+    if (m_bestG < publishedG)
+    {
+      publishedG = m_bestG;
+      ++m_statistics.solutions;
+      onSolution(restoreSteps(m_nodes, m_goal, m_space.cols()), bound);
+    }
+    if (m_stopped || bound <= 1. || m_config.weightStep <= 0.)
+    {
+      break;
+    }
+
+    // next search with smaller weight: improved nodes are queued again, the open list is
+    // reordered and expanded nodes are forgotten
+    m_weight = std::max(m_weight - m_config.weightStep, 1.);
+    for (NodeId node : m_inconsistent)
+    {
+      m_isInconsistent[node] = false;
+      push(node);
+    }
+    m_inconsistent.clear();
+    for (Entry &entry : m_open)
+    {
+      entry.f = entry.g + m_weight * entry.h;
+    }
+    std::make_heap(m_open.begin(), m_open.end(), Greater());
+    ++m_search;
+    ++m_statistics.iterations;
+  }
+
+  m_statistics.closedSet = m_closedSet.statistics();
+  m_statistics.nodes = m_nodes.size();
+  m_statistics.arenaBytes = m_nodes.bytesUsed();
+  return m_goal != g_noNode;
+}
+
+void AraStar::push(NodeId node)
+{
+  const uint32_t g = m_nodes.header(node).g;
+  m_open.push_back({g + m_weight * m_h[node], m_h[node], node, g});
+  std::push_heap(m_open.begin(), m_open.end(), Greater());
+}
+
+AraStar::Entry AraStar::pop()
+{
+  std::pop_heap(m_open.begin(), m_open.end(), Greater());
+  Entry result = m_open.back();
+  m_open.pop_back();
+  return result;
+}
+
+void AraStar::improvePath()
+{
+  while (!m_open.empty() && m_open.front().f < m_bestG)
+  {
+    const Entry entry = pop();
+    if (entry.g != m_nodes.header(entry.node).g || m_expandedIn[entry.node] == m_search)
+    {
+      // improved after the entry had been queued or already expanded by this search
+      continue;
+    }
+    if (m_config.maxNodes != 0 && m_nodes.size() >= m_config.maxNodes)
+    {
+      m_stopped = true;
+      return;
+    }
+    expand(entry.node);
+  }
+}
+
+void AraStar::pushBound(NodeId node)
+{
+  const uint32_t g = m_nodes.header(node).g;
+  m_bounds.push_back({size_t(g) + m_h[node], node, g});
+  std::push_heap(m_bounds.begin(), m_bounds.end(), std::greater<Bound>());
+}
+
+void AraStar::expand(NodeId current)
+{
+  m_expandedIn[current] = m_search;
+  m_closed[current] = true;
+  ++m_statistics.expanded;
+  m_successors.clear();
+  m_space.expand(m_nodes.state(current), m_nodes.header(current).hash, m_successors);
+  m_statistics.generated += m_successors.size();
+
+  for (const Successor &successor : m_successors)
+  {
+    const uint32_t g = m_nodes.header(current).g + successor.cost;
+    auto inserted = m_closedSet.findOrInsert(
+        successor.hash, [&](NodeId n) { return m_nodes.equal(n, successor.state); },
+        [&]() { return m_nodes.allocate(current, successor.hash, successor.state.cells(), g); });
+    const NodeId node = *inserted.first;
+    if (inserted.second)
+    {
+      m_expandedIn.push_back(0);
+      m_isInconsistent.push_back(false);
+      m_closed.push_back(false);
+      HeuristicValue h = g_unsolvable;
+      if (m_space.isValid(successor, m_mapState))
+      {
+        ++m_statistics.heuristicCalls;
+        h = m_heuristic.evaluate(m_mapState, node, m_space.boxMove(current, successor));
+      }
+      m_h.push_back(h);
+    }
+    else
+    {
+      NodeHeader &header = m_nodes.header(node);
+      if (header.g <= g)
+      {
+        continue;
+      }
+      header.g = g;
+      header.parent = current;
+      m_closed[node] = false;
+      ++m_statistics.reopened;
+    }
+
+    const HeuristicValue h = m_h[node];
+    if (h == g_unsolvable)
+    {
+      continue;
+    }
+    if (h == 0)
+    {
+      if (g < m_bestG)
+      {
+        m_bestG = g;
+        m_goal = node;
+      }
+      continue;
+    }
+    pushBound(node);
+    if (m_expandedIn[node] != m_search)
+    {
+      push(node);
+    }
+    else if (!m_isInconsistent[node])
+    {
+      m_isInconsistent[node] = true;
+      m_inconsistent.push_back(node);
+    }
+  }
+}
+
+size_t AraStar::minOpenF()
+{
+  while (!m_bounds.empty())
+  {
+    const Bound &top = m_bounds.front();
+    if (top.g == m_nodes.header(top.node).g && !m_closed[top.node])
+    {
+      return top.f;
+    }
+    std::pop_heap(m_bounds.begin(), m_bounds.end(), std::greater<Bound>());
+    m_bounds.pop_back();
+  }
+  return g_inf;
+}
+
+} // namespace soko
@@ -0,0 +1,96 @@
+#pragma once
+
+#include <functional>
+
+#include "soko/node_arena.h"
+#include "soko/search_space.h"
+#include "soko/solver.h"
+#include "soko/transposition_table.hpp"
+
+namespace soko
+{
+
+// Anytime repairing A*: weighted A* with f = g + w * h, which continues after a solution with
+// a smaller weight. The search tree is kept between searches: nodes, improved after they were
+// expanded in the current search, are collected apart and queued for the next one.
+// Every better solution is reported with the proven bound of its suboptimality.
+class AraStar {
+public:
+  // Solution pushes and the bound: solution is at most `bound` times longer than the optimal one
+  using SolutionCallback = std::function<void(const std::vector<BoxMovement> &, double bound)>;
+
+  AraStar(SearchSpace &space, const Heuristic &heuristic, const SolverConfig &config,
+          SolverStatistics &statistics);
+
+  // Returns false if no solution is found
+  bool solve(const SolutionCallback &onSolution);
+
+private:
+  struct Entry
+  {
+    double f;
+    HeuristicValue h;
+    NodeId node;
+    uint32_t g;
+  };
+
+  struct Greater
+  {
+    bool operator()(const Entry &left, const Entry &right) const noexcept
+    {
+      return left.f > right.f || (left.f == right.f && left.h > right.h);
+    }
+  };
+
+  // Entry of the unweighted g + h of a node, waiting for expansion
+  struct Bound
+  {
+    size_t f;
+    NodeId node;
+    uint32_t g;
+
+    bool operator>(const Bound &right) const noexcept { return f > right.f; }
+  };
+
+  void push(NodeId node);
+  Entry pop();
+  // Searches with the current weight, until no open node has less f than the best solution
+  void improvePath();
+  void expand(NodeId current);
+  // Node with the g and h waits for expansion
+  void pushBound(NodeId node);
+  // Least g + h of nodes, waiting for expansion. Bounds of expanded nodes and of outdated g
+  // are dropped on the way, so the bound costs amortized O(log open) per node
+  size_t minOpenF();
+
+private:
+  SearchSpace &m_space;
+  const Heuristic &m_heuristic;
+  const SolverConfig &m_config;
+  SolverStatistics &m_statistics;
+
+  NodeArena m_nodes;
+  TranspositionTable<NodeId> m_closedSet;
+  std::vector<HeuristicValue> m_h;
+  // search, which expanded the node last time
+  std::vector<uint32_t> m_expandedIn;
+  // binary heap of the current search and nodes, improved after their expansion
+  std::vector<Entry> m_open;
+  std::vector<NodeId> m_inconsistent;
+  std::vector<bool> m_isInconsistent;
+  // min-heap of the open and inconsistent nodes by g + h; node is closed, when it's expanded
+  // with its current g
+  std::vector<Bound> m_bounds;
+  std::vector<bool> m_closed;
+
+  double m_weight = 1;
+  uint32_t m_search = 1;
+  bool m_stopped = false;
+  size_t m_bestG = g_inf;
+  NodeId m_goal = g_noNode;
+
+  std::vector<Successor> m_successors;
+  MapState m_mapState;
+};
+
+} // namespace soko
@@ -0,0 +1,220 @@
+#include "soko/bidirectional_search.h"
+
+namespace soko
+{
+
+namespace
+{
+
+// Level, which solution is the reversed solution of the original level: boxes start on
+// destinations and are moved to the initial box positions
+Map pullMap(const MapStatic &map, const MapState &initial)
+{
+  Map result = map;
+  std::vector<Pos> destinations;
+  for (size_t i = 0; i < result.rows(); ++i)
+  {
+    for (size_t j = 0; j < result.cols(); ++j)
+    {
+      if (result.isDestination({i, j}))
+      {
+        destinations.push_back({i, j});
+        result.at(i, j) = removeItem(result.at(i, j), Cell::Destination);
+      }
+    }
+  }
+  for (auto box : initial.boxes)
+  {
+    result.at(box) = placeItem(result.at(box), Cell::Destination);
+  }
+  for (auto destination : destinations)
+  {
+    result.at(destination) = placeItem(result.at(destination), Cell::Box);
+  }
+  // unit isn't used by the heuristic: any free cell will do
+  auto unit = std::find_if(result.begin(), result.end(),
+                           [](Cell c) { return c == Cell::Field || c == Cell::Destination; });
+  assert(unit != result.end());
+  *unit = placeItem(*unit, Cell::Unit);
+  return result;
+}
+
+} // namespace
+
+BidirectionalSearch::BidirectionalSearch(SearchSpace &space, const Heuristic &heuristic,
+                                         const SolverConfig &config,
+                                         SolverStatistics &statistics)
+  : m_space(space)
+  , m_config(config)
+  , m_statistics(statistics)
+  , m_pullHeuristic(Heuristic::create(HeuristicType::HungarianPull))
+{
+  m_pullHeuristic->init(pullMap(space.map(), space.initialState()));
+  m_forward.pulls = false;
+  m_forward.heuristic = &heuristic;
+  m_backward.pulls = true;
+  m_backward.heuristic = m_pullHeuristic.get();
+  for (Direction *direction : {&m_forward, &m_backward})
+  {
+    direction->nodes.reset(space.root().cellCount());
+  }
+}
+
+bool BidirectionalSearch::solve(std::vector<BoxMovement> &result)
+{
+  const NodeId root = insert(m_forward, g_noNode, m_space.root(), m_space.rootHash(), 0);
+  ++m_statistics.heuristicCalls;
+  const HeuristicValue rootH = m_forward.heuristic->evaluate(m_space.initialState(), root);
+  if (rootH == g_unsolvable)
+  {
+    return false;
+  }
+  for (const CompactState &goal : m_space.goalStates())
+  {
+    const NodeId node = insert(m_backward, g_noNode, goal, m_space.hash(goal), 0);
+    ++m_statistics.heuristicCalls;
+    push(m_backward, node, 0, m_backward.heuristic->evaluate(goal.toMapState(m_space.cols()), node));
+  }
+  push(m_forward, root, 0, rootH);
+
+  bool stopped = false;
+  while (!m_forward.open.empty() && !m_backward.open.empty())
+  {
+    Direction &direction =
+        m_forward.open.size() <= m_backward.open.size() ? m_forward : m_backward;
+    const OpenEntry entry = direction.open.pop();
+    if (entry.g != direction.nodes.header(entry.node).g)
+    {
+      // node was reopened with fewer moves after the entry had been queued
+      continue;
+    }
+    if (entry.f() >= m_bestLength)
+    {
+      // neither direction can join a shorter path
+      break;
+    }
+    if (m_config.maxNodes != 0 &&
+        m_forward.nodes.size() + m_backward.nodes.size() >= m_config.maxNodes)
+    {
+      stopped = true;
+      break;
+    }
+    expand(direction, entry);
+  }
+
+  m_statistics.nodes = m_forward.nodes.size() + m_backward.nodes.size();
+  m_statistics.backwardNodes = m_backward.nodes.size();
+  m_statistics.arenaBytes = m_forward.nodes.bytesUsed() + m_backward.nodes.bytesUsed();
+  m_statistics.closedSet = m_forward.closed.statistics();
+  m_statistics.closedSet.merge(m_backward.closed.statistics());
+  if (stopped || m_bestLength == g_inf)
+  {
+    return false;
+  }
+
+  // pushes up to the common state, then pulls of the backward path in reverse
+  const size_t cols = m_space.cols();
+  result.clear();
+  for (NodeId node = m_forwardMeeting; m_forward.nodes.header(node).parent != g_noNode;)
+  {
+    const NodeId parent = m_forward.nodes.header(node).parent;
+    result.push_back(
+        restoreSingleStep(m_forward.nodes.state(parent), m_forward.nodes.state(node), cols));
+    node = parent;
+  }
+  std::reverse(result.begin(), result.end());
+  for (NodeId node = m_backwardMeeting; m_backward.nodes.header(node).parent != g_noNode;)
+  {
+    const NodeId parent = m_backward.nodes.header(node).parent;
+    result.push_back(
+        restoreSingleStep(m_backward.nodes.state(node), m_backward.nodes.state(parent), cols));
+    node = parent;
+  }
+  return true;
+}
+
+NodeId BidirectionalSearch::insert(Direction &direction, NodeId parent, const CompactState &state,
+                                   StateHash hash, uint32_t g)
+{
+  NodeArena &nodes = direction.nodes;
+  auto inserted = direction.closed.findOrInsert(
+      hash, [&](NodeId n) { return nodes.equal(n, state); },
+      [&]() { return nodes.allocate(parent, hash, state.cells(), g); });
+  if (inserted.second)
+  {
+    return *inserted.first;
+  }
+  NodeHeader &header = nodes.header(*inserted.first);
+  if (!m_config.reopenNodes || header.g <= g)
+  {
+    return g_noNode;
+  }
+  header.g = g;
+  header.parent = parent;
+  ++m_statistics.reopened;
+  return *inserted.first;
+}
+
+void BidirectionalSearch::push(Direction &direction, NodeId node, uint32_t g, HeuristicValue h)
+{
+  if (h == g_unsolvable)
+  {
+    return;
+  }
+  direction.open.push(node, g, h);
+
+  Direction &other = direction.pulls ? m_forward : m_backward;
+  const NodeHeader &header = direction.nodes.header(node);
+  const NodeId *met = other.closed.find(header.hash, [&](NodeId n) {
+    return other.nodes.equal(n, direction.nodes.state(node));
+  });
+  if (met == nullptr || g + other.nodes.header(*met).g >= m_bestLength)
+  {
+    return;
+  }
+  m_bestLength = g + other.nodes.header(*met).g;
+  m_forwardMeeting = direction.pulls ? *met : node;
+  m_backwardMeeting = direction.pulls ? node : *met;
+}
+
+void BidirectionalSearch::expand(Direction &direction, const OpenEntry &entry)
+{
+  ++m_statistics.expanded;
+  const NodeId current = entry.node;
+  const CompactState state = direction.nodes.state(current);
+  m_successors.clear();
+  if (direction.pulls)
+  {
+    m_space.expandPulls(state, direction.nodes.header(current).hash, m_successors);
+  }
+  else
+  {
+    m_space.expand(state, direction.nodes.header(current).hash, m_successors);
+  }
+  m_statistics.generated += m_successors.size();
+
+  for (const Successor &successor : m_successors)
+  {
+    const uint32_t g = static_cast<uint32_t>(entry.g + successor.cost);
+    const NodeId node = insert(direction, current, successor.state, successor.hash, g);
+    if (node == g_noNode)
+    {
+      continue;
+    }
+    if (direction.pulls)
+    {
+      // state after a pull is never a deadlock: pushes lead it back to the goal
+      toMapState(successor.state.cells(), successor.state.cellCount(), m_space.cols(),
+                 m_mapState);
+    }
+    else if (!m_space.isValid(successor, m_mapState))
+    {
+      continue;
+    }
+    ++m_statistics.heuristicCalls;
+    push(direction, node, g,
+         direction.heuristic->evaluate(m_mapState, node, m_space.boxMove(current, successor)));
+  }
+}
+
+} // namespace soko
@@ -0,0 +1,59 @@
+#pragma once
+
+#include "soko/node_arena.h"
+#include "soko/open_list.h"
+#include "soko/search_space.h"
+#include "soko/solver.h"
+#include "soko/transposition_table.hpp"
+
+namespace soko
+{
+
+// Bidirectional A*: forward push search from the initial state and backward pull search from
+// the goal states, one for each unit area. Backward states are evaluated with the distance of
+// boxes to their initial positions. A state, stored by both searches, joins the paths; the best
+// joined path is optimal, when no open node of the expanded direction has less f.
+// The direction with fewer open nodes is expanded first.
+class BidirectionalSearch {
+public:
+  BidirectionalSearch(SearchSpace &space, const Heuristic &heuristic, const SolverConfig &config,
+                      SolverStatistics &statistics);
+
+  // Returns false if there is no solution or the node limit is reached
+  bool solve(std::vector<BoxMovement> &result);
+
+private:
+  struct Direction
+  {
+    bool pulls;
+    const Heuristic *heuristic;
+    NodeArena nodes;
+    TranspositionTable<NodeId> closed;
+    BucketQueue open;
+  };
+
+  // Stores the node or reopens it with fewer moves. Returns g_noNode if there is nothing to do
+  NodeId insert(Direction &direction, NodeId parent, const CompactState &state, StateHash hash,
+                uint32_t g);
+  void push(Direction &direction, NodeId node, uint32_t g, HeuristicValue h);
+  void expand(Direction &direction, const OpenEntry &entry);
+
+private:
+  SearchSpace &m_space;
+  const SolverConfig &m_config;
+  SolverStatistics &m_statistics;
+  // heuristic of the backward search: initial box positions are its destinations
+  std::unique_ptr<Heuristic> m_pullHeuristic;
+  Direction m_forward;
+  Direction m_backward;
+
+  // shortest joined path: its length and the common state in both directions
+  size_t m_bestLength = g_inf;
+  NodeId m_forwardMeeting = g_noNode;
+  NodeId m_backwardMeeting = g_noNode;
+
+  std::vector<Successor> m_successors;
+  MapState m_mapState;
+};
+
+} // namespace soko
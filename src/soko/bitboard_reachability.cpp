@@ -0,0 +1,211 @@
+#include "soko/bitboard_reachability.h"
+
+#include <stdexcept>
+
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#define SOKO_AVX2_DISPATCH
+#include <immintrin.h>
+#endif
+
+namespace soko
+{
+
+namespace
+{
+
+using Row = BitboardReachability::Row;
+
+size_t lowestBit(Row r) noexcept
+{
+  assert(r != 0);
+#if defined(__GNUC__) || defined(__clang__)
+  return static_cast<size_t>(__builtin_ctzll(r));
+#else
+  size_t result = 0;
+  while ((r & 1) == 0)
+  {
+    r >>= 1;
+    ++result;
+  }
+  return result;
+#endif
+}
+
+// Spreads the area along the row until it stops changing
+Row spreadRow(Row reached, Row free) noexcept
+{
+  reached &= free;
+  while (true)
+  {
+    Row next = (reached | reached << 1 | reached >> 1) & free;
+    if (next == reached)
+    {
+      return reached;
+    }
+    reached = next;
+  }
+}
+
+} // namespace
+
+bool BitboardReachability::avx2Supported() noexcept
+{
+#ifdef SOKO_AVX2_DISPATCH
+  return __builtin_cpu_supports("avx2");
+#else
+  return false;
+#endif
+}
+
+BitboardReachability::BitboardReachability(const MapStatic &m)
+  : m_cols(m.cols())
+  , m_rows(m.rows())
+  , m_avx2(avx2Supported())
+{
+  if (!supports(m))
+  {
+    throw std::logic_error("Map is too wide for bitboard reachability");
+  }
+  checkCellIndexable(m);
+  // padding row on both sides, map rows are rounded up to a whole number of AVX2 blocks
+  const size_t size = (m_rows + 3) / 4 * 4 + 2;
+  m_fields.assign(size, 0);
+  m_reached.assign(size, 0);
+  for (size_t i = 0; i < m_rows; ++i)
+  {
+    for (size_t j = 0; j < m_cols; ++j)
+    {
+      if (m.at(i, j) != Cell::Wall)
+      {
+        m_fields[i + 1] |= Row(1) << j;
+      }
+    }
+  }
+  m_free = m_fields;
+}
+
+void BitboardReachability::setBoxes(const CellIndex *boxes, size_t count)
+{
+  m_free = m_fields;
+  for (size_t i = 0; i < count; ++i)
+  {
+    m_free[rowOf(boxes[i])] &= ~bitOf(boxes[i]);
+  }
+}
+
+CellIndex BitboardReachability::fill(CellIndex from)
+{
+  assert(isFree(from));
+  std::fill(m_reached.begin(), m_reached.end(), 0);
+  m_reached[rowOf(from)] = bitOf(from);
+  if (m_avx2)
+  {
+    spreadAvx2();
+  }
+  else
+  {
+    spreadScalar();
+  }
+
+  for (size_t i = 1; i <= m_rows; ++i)
+  {
+    if (m_reached[i] != 0)
+    {
+      return static_cast<CellIndex>((i - 1) * m_cols + lowestBit(m_reached[i]));
+    }
+  }
+  assert(false);
+  return from;
+}
+
+void BitboardReachability::spreadScalar()
+{
+  // sweeps down and up: the area moves through any number of rows in a single sweep
+  bool changed = true;
+  while (changed)
+  {
+    changed = false;
+    for (size_t i = 1; i <= m_rows; ++i)
+    {
+      Row grown = spreadRow(m_reached[i] | m_reached[i - 1] | m_reached[i + 1], m_free[i]);
+      changed |= grown != m_reached[i];
+      m_reached[i] = grown;
+    }
+    for (size_t i = m_rows; i >= 1; --i)
+    {
+      Row grown = spreadRow(m_reached[i] | m_reached[i - 1] | m_reached[i + 1], m_free[i]);
+      changed |= grown != m_reached[i];
+      m_reached[i] = grown;
+    }
+  }
+}
+
+#ifdef SOKO_AVX2_DISPATCH
+
+namespace
+{
+
+// One step of a block of four rows: row neighbours and the same columns of adjacent rows
+__attribute__((target("avx2"))) __m256i growBlock(const Row *reached, __m256i free) noexcept
+{
+  __m256i current = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(reached));
+  __m256i up = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(reached - 1));
+  __m256i down = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(reached + 1));
+  __m256i grown = _mm256_and_si256(_mm256_or_si256(current, _mm256_or_si256(up, down)), free);
+  while (true)
+  {
+    __m256i next = _mm256_or_si256(
+        grown, _mm256_or_si256(_mm256_slli_epi64(grown, 1), _mm256_srli_epi64(grown, 1)));
+    next = _mm256_and_si256(next, free);
+    __m256i diff = _mm256_xor_si256(next, grown);
+    grown = next;
+    if (_mm256_testz_si256(diff, diff))
+    {
+      return grown;
+    }
+  }
+}
+
+__attribute__((target("avx2"))) bool sweepAvx2(Row *reached, const Row *free, size_t blocks,
+                                                bool down) noexcept
+{
+  bool changed = false;
+  for (size_t b = 0; b < blocks; ++b)
+  {
+    size_t offset = 1 + 4 * (down ? b : blocks - 1 - b);
+    __m256i freeBlock = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(free + offset));
+    __m256i current = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(reached + offset));
+    __m256i grown = growBlock(reached + offset, freeBlock);
+    __m256i diff = _mm256_xor_si256(grown, current);
+    if (!_mm256_testz_si256(diff, diff))
+    {
+      _mm256_storeu_si256(reinterpret_cast<__m256i *>(reached + offset), grown);
+      changed = true;
+    }
+  }
+  return changed;
+}
+
+} // namespace
+
+void BitboardReachability::spreadAvx2()
+{
+  const size_t blocks = (m_rows + 3) / 4;
+  bool changed = true;
+  while (changed)
+  {
+    changed = sweepAvx2(m_reached.data(), m_free.data(), blocks, true);
+    changed |= sweepAvx2(m_reached.data(), m_free.data(), blocks, false);
+  }
+}
+
+#else
+
+void BitboardReachability::spreadAvx2()
+{
+  spreadScalar();
+}
+
+#endif
+
+} // namespace soko
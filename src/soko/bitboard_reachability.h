@@ -0,0 +1,61 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "soko/compact_state.h"
+
+namespace soko
+{
+
+// Unit reachability on bitboards: one 64-bit word per map row, bit j stands for column j.
+// The area grows by shift/and/or steps over all rows until it stops changing. Rows are processed
+// four at a time with AVX2 if the processor supports it (checked at runtime), otherwise one
+// by one. Maps wider than 64 columns are not supported.
+class BitboardReachability {
+public:
+  using Row = uint64_t;
+  static constexpr size_t g_maxCols = 64;
+
+  static bool supports(const MapStatic &m) noexcept { return m.cols() <= g_maxCols; }
+  static bool avx2Supported() noexcept;
+
+  BitboardReachability() = default;
+  // throws std::logic_error if the map is not supported
+  explicit BitboardReachability(const MapStatic &m);
+
+  void setBoxes(const CellIndex *boxes, size_t count);
+  void moveBox(CellIndex from, CellIndex to) noexcept
+  {
+    m_free[rowOf(from)] |= bitOf(from);
+    m_free[rowOf(to)] &= ~bitOf(to);
+  }
+
+  // Marks the area, reachable from `from`.
+  // Returns the minimal cell of the area, i.e. normalized unit position.
+  CellIndex fill(CellIndex from);
+  bool isReachable(CellIndex c) const noexcept { return (m_reached[rowOf(c)] & bitOf(c)) != 0; }
+  bool isFree(CellIndex c) const noexcept { return (m_free[rowOf(c)] & bitOf(c)) != 0; }
+
+  bool usesAvx2() const noexcept { return m_avx2; }
+  // Turns AVX2 off (or back on, if supported) for comparing implementations
+  void setAvx2(bool enable) noexcept { m_avx2 = enable && avx2Supported(); }
+
+private:
+  // row 0 and rows after the map are empty padding: neighbour rows can be read without checks
+  size_t rowOf(CellIndex c) const noexcept { return c / m_cols + 1; }
+  Row bitOf(CellIndex c) const noexcept { return Row(1) << (c % m_cols); }
+
+  void spreadScalar();
+  void spreadAvx2();
+
+  size_t m_cols = 0;
+  size_t m_rows = 0;
+  bool m_avx2 = false;
+  std::vector<Row> m_fields;
+  // fields without boxes
+  std::vector<Row> m_free;
+  std::vector<Row> m_reached;
+};
+
+} // namespace soko
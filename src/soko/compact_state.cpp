@@ -0,0 +1,144 @@
+#include "soko/compact_state.h"
+
+namespace soko
+{
+
+void checkCellIndexable(const Map &m)
+{
+  if (m.rows() * m.cols() >= g_noCell)
+  {
+    throw std::logic_error("Map is too big: " + std::to_string(m.rows() * m.cols()) + " cells");
+  }
+}
+
+CompactState::CompactState(const MapState &state, size_t cols)
+{
+  assert(std::is_sorted(state.boxes.begin(), state.boxes.end()));
+  allocate(state.boxes.size() + 1);
+  CellIndex *cells = data();
+  for (size_t i = 0; i < state.boxes.size(); ++i)
+  {
+    cells[i] = toCellIndex(state.boxes[i], cols);
+  }
+  cells[state.boxes.size()] = toCellIndex(state.unit, cols);
+}
+
+CompactState::CompactState(const CellIndex *cells, size_t count)
+{
+  allocate(count);
+  std::memcpy(data(), cells, count * sizeof(CellIndex));
+}
+
+CompactState::CompactState(const CompactState &other)
+{
+  allocate(other.m_size);
+  std::memcpy(data(), other.data(), m_size * sizeof(CellIndex));
+}
+
+CompactState::CompactState(CompactState &&other) noexcept { steal(other); }
+
+CompactState &CompactState::operator=(const CompactState &other)
+{
+  if (this != &other)
+  {
+    if (m_size != other.m_size)
+    {
+      release();
+      allocate(other.m_size);
+    }
+    std::memcpy(data(), other.data(), m_size * sizeof(CellIndex));
+  }
+  return *this;
+}
+
+CompactState &CompactState::operator=(CompactState &&other) noexcept
+{
+  if (this != &other)
+  {
+    release();
+    steal(other);
+  }
+  return *this;
+}
+
+MapState toMapState(const CellIndex *cells, size_t count, size_t cols)
+{
+  MapState result;
+  toMapState(cells, count, cols, result);
+  return result;
+}
+
+void toMapState(const CellIndex *cells, size_t count, size_t cols, MapState &result)
+{
+  assert(count != 0);
+  result.boxes.resize(count - 1);
+  for (size_t i = 0; i + 1 < count; ++i)
+  {
+    result.boxes[i] = toPos(cells[i], cols);
+  }
+  result.unit = toPos(cells[count - 1], cols);
+}
+
+bool CompactState::isBox(CellIndex c) const noexcept
+{
+  return std::binary_search(boxes(), boxes() + boxCount(), c);
+}
+
+size_t CompactState::moveBox(size_t idx, CellIndex to) noexcept
+{
+  assert(idx < boxCount());
+  CellIndex *cells = data();
+  // shift neighbours in order to keep boxes sorted
+  while (idx > 0 && cells[idx - 1] > to)
+  {
+    cells[idx] = cells[idx - 1];
+    --idx;
+  }
+  while (idx + 1 < boxCount() && cells[idx + 1] < to)
+  {
+    cells[idx] = cells[idx + 1];
+    ++idx;
+  }
+  cells[idx] = to;
+  return idx;
+}
+
+void CompactState::allocate(size_t size)
+{
+  assert(m_size == 0);
+  if (size >= g_noCell)
+  {
+    throw std::logic_error("Too many boxes: " + std::to_string(size - 1));
+  }
+  m_size = static_cast<uint16_t>(size);
+  if (!isInline())
+  {
+    setHeap(new CellIndex[size]);
+  }
+}
+
+void CompactState::release() noexcept
+{
+  if (!isInline())
+  {
+    delete[] heap();
+  }
+  m_size = 0;
+}
+
+void CompactState::steal(CompactState &other) noexcept
+{
+  assert(m_size == 0);
+  // inline cells and heap pointer are moved the same way
+  m_size = other.m_size;
+  std::memcpy(m_inline, other.m_inline, sizeof(m_inline));
+  other.m_size = 0;
+}
+
+bool operator==(const CompactState &l, const CompactState &r) noexcept
+{
+  return l.cellCount() == r.cellCount() &&
+         std::memcmp(l.cells(), r.cells(), l.cellCount() * sizeof(CellIndex)) == 0;
+}
+
+} // namespace soko
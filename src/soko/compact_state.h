@@ -0,0 +1,100 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <limits>
+
+#include "soko/heuristic.h"
+
+namespace soko
+{
+
+// Flat index of a map cell: i * cols + j
+using CellIndex = uint16_t;
+constexpr CellIndex g_noCell = std::numeric_limits<CellIndex>::max();
+
+constexpr CellIndex toCellIndex(Pos p, size_t cols) noexcept
+{
+  return static_cast<CellIndex>(p.i * cols + p.j);
+}
+
+constexpr Pos toPos(CellIndex c, size_t cols) noexcept { return {c / cols, c % cols}; }
+
+// Throws if map cells can't be numbered with CellIndex
+void checkCellIndexable(const Map &m);
+
+// cells: sorted boxes followed by the unit
+MapState toMapState(const CellIndex *cells, size_t count, size_t cols);
+// Reuses memory of the result
+void toMapState(const CellIndex *cells, size_t count, size_t cols, MapState &result);
+
+// MapState in a compact form: sorted box cells followed by the unit cell.
+// Small states are kept inline, the bigger ones fall back to the heap.
+class CompactState {
+public:
+  static constexpr size_t g_inlineCells = 15;
+
+  CompactState() noexcept = default;
+  CompactState(const MapState &state, size_t cols);
+  CompactState(const CellIndex *cells, size_t count);
+  CompactState(const CompactState &other);
+  CompactState(CompactState &&other) noexcept;
+  CompactState &operator=(const CompactState &other);
+  CompactState &operator=(CompactState &&other) noexcept;
+  ~CompactState() { release(); }
+
+  MapState toMapState(size_t cols) const { return soko::toMapState(data(), m_size, cols); }
+
+  size_t boxCount() const noexcept { return m_size == 0 ? 0 : m_size - 1u; }
+  const CellIndex *boxes() const noexcept { return data(); }
+  CellIndex unit() const noexcept
+  {
+    assert(m_size != 0);
+    return data()[m_size - 1];
+  }
+  void setUnit(CellIndex unit) noexcept
+  {
+    assert(m_size != 0);
+    data()[m_size - 1] = unit;
+  }
+
+  bool isBox(CellIndex c) const noexcept;
+  // Moves box with index idx to the cell `to` keeping boxes sorted.
+  // Returns new index of the moved box.
+  size_t moveBox(size_t idx, CellIndex to) noexcept;
+
+  // boxes + unit
+  const CellIndex *cells() const noexcept { return data(); }
+  size_t cellCount() const noexcept { return m_size; }
+
+  // Bytes, occupied by the state including heap storage
+  size_t memoryUsage() const noexcept
+  {
+    return sizeof(CompactState) + (isInline() ? 0 : m_size * sizeof(CellIndex));
+  }
+
+private:
+  bool isInline() const noexcept { return m_size <= g_inlineCells; }
+  CellIndex *data() noexcept { return isInline() ? m_inline : heap(); }
+  const CellIndex *data() const noexcept { return isInline() ? m_inline : heap(); }
+  // Heap pointer is kept inside the inline storage, so the state needs no pointer alignment
+  CellIndex *heap() const noexcept
+  {
+    CellIndex *result;
+    std::memcpy(&result, m_inline, sizeof(result));
+    return result;
+  }
+  void setHeap(CellIndex *p) noexcept { std::memcpy(m_inline, &p, sizeof(p)); }
+  void allocate(size_t size);
+  void release() noexcept;
+  void steal(CompactState &other) noexcept;
+
+private:
+  uint16_t m_size = 0;
+  CellIndex m_inline[g_inlineCells];
+};
+
+bool operator==(const CompactState &l, const CompactState &r) noexcept;
+inline bool operator!=(const CompactState &l, const CompactState &r) noexcept { return !(l == r); }
+
+} // namespace soko
@@ -0,0 +1,465 @@
+#include "soko/external_astar.h"
+
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <queue>
+#include <random>
+#include <stdexcept>
+
+namespace soko
+{
+
+namespace
+{
+
+namespace fs = std::filesystem;
+
+// records, read or written by a single stream operation
+constexpr size_t g_blockRecords = 4096;
+// records, buffered by each open list bucket
+constexpr size_t g_bucketRecords = 1024;
+// record cells of the heuristic key
+constexpr size_t g_keyCells = sizeof(size_t) / sizeof(CellIndex);
+
+void writeRecords(std::ofstream &file, const std::vector<CellIndex> &records,
+                  const std::string &path, SolverStatistics &statistics)
+{
+  const size_t bytes = records.size() * sizeof(CellIndex);
+  file.write(reinterpret_cast<const char *>(records.data()), static_cast<std::streamsize>(bytes));
+  if (!file)
+  {
+    throw std::runtime_error("Can't write scratch file " + path);
+  }
+  statistics.scratchBytes += bytes;
+}
+
+// Sequential reader of a record file
+class RecordReader {
+public:
+  RecordReader(const std::string &path, size_t width)
+    : m_file(path, std::ios::binary)
+    , m_width(width)
+  {
+    if (!m_file)
+    {
+      throw std::runtime_error("Can't read scratch file " + path);
+    }
+    fill();
+  }
+
+  bool valid() const noexcept { return m_position < m_size; }
+  const CellIndex *record() const noexcept { return m_buffer.data() + m_position * m_width; }
+  void next()
+  {
+    if (++m_position == m_size)
+    {
+      fill();
+    }
+  }
+
+private:
+  void fill()
+  {
+    m_buffer.resize(g_blockRecords * m_width);
+    m_file.read(reinterpret_cast<char *>(m_buffer.data()),
+                static_cast<std::streamsize>(m_buffer.size() * sizeof(CellIndex)));
+    m_size = static_cast<size_t>(m_file.gcount()) / (m_width * sizeof(CellIndex));
+    m_position = 0;
+  }
+
+private:
+  std::ifstream m_file;
+  size_t m_width;
+  std::vector<CellIndex> m_buffer;
+  size_t m_position = 0;
+  size_t m_size = 0;
+};
+
+// Buffered writer of a record file. Records are written completely by close()
+class RecordWriter {
+public:
+  RecordWriter(const std::string &path, size_t width, SolverStatistics &statistics)
+    : m_file(path, std::ios::binary)
+    , m_path(path)
+    , m_width(width)
+    , m_statistics(statistics)
+  {
+    m_buffer.reserve(g_blockRecords * m_width);
+  }
+
+  void write(const CellIndex *record)
+  {
+    m_buffer.insert(m_buffer.end(), record, record + m_width);
+    if (m_buffer.size() >= g_blockRecords * m_width)
+    {
+      flush();
+    }
+  }
+  void close()
+  {
+    flush();
+    m_file.close();
+  }
+
+private:
+  void flush()
+  {
+    writeRecords(m_file, m_buffer, m_path, m_statistics);
+    m_buffer.clear();
+  }
+
+private:
+  std::ofstream m_file;
+  std::string m_path;
+  size_t m_width;
+  SolverStatistics &m_statistics;
+  std::vector<CellIndex> m_buffer;
+};
+
+} // namespace
+
+ExternalAStar::ExternalAStar(SearchSpace &space, const Heuristic &heuristic,
+                             const SolverConfig &config, SolverStatistics &statistics)
+  : m_space(space)
+  , m_heuristic(heuristic)
+  , m_config(config)
+  , m_statistics(statistics)
+{
+  const fs::path base = config.scratchDirectory.empty() ? fs::temp_directory_path()
+                                                        : fs::path(config.scratchDirectory);
+  std::random_device random;
+  fs::path directory;
+  do
+  {
+    directory = base / ("soko-" + std::to_string(random()));
+  } while (!fs::create_directories(directory));
+  m_directory = directory.string();
+}
+
+ExternalAStar::~ExternalAStar()
+{
+  std::error_code ignored;
+  fs::remove_all(m_directory, ignored);
+}
+
+bool ExternalAStar::solve(std::vector<BoxMovement> &result)
+{
+  const CompactState &root = m_space.root();
+  m_stateCells = root.cellCount();
+  m_width = m_stateCells + 2 + g_keyCells;
+  ++m_statistics.heuristicCalls;
+  const size_t rootKey = ++m_lastKey;
+  const HeuristicValue rootH = m_heuristic.evaluate(m_space.initialState(), rootKey);
+  if (rootH == g_unsolvable)
+  {
+    return false;
+  }
+  if (rootH == 0)
+  {
+    result.clear();
+    return true;
+  }
+  makeRecord(root.cells(), g_noCell, g_noCell, rootKey);
+  append(rootH, 0, m_record.data());
+  m_closed = newFile();
+  RecordWriter(m_closed, m_width, m_statistics).close();
+
+  bool solved = false;
+  while (!m_open.empty() && !solved)
+  {
+    if (m_config.maxNodes != 0 && m_statistics.nodes >= m_config.maxNodes)
+    {
+      break;
+    }
+    auto first = m_open.begin();
+    const auto key = first->first;
+    Bucket bucket = std::move(first->second);
+    m_open.erase(first);
+    solved = expandBucket(key.first, key.second, bucket);
+  }
+  if (solved)
+  {
+    result = restorePath(m_goal);
+  }
+  return solved;
+}
+
+std::string ExternalAStar::newFile()
+{
+  return (fs::path(m_directory) / (std::to_string(m_files++) + ".bin")).string();
+}
+
+void ExternalAStar::append(size_t f, size_t g, const CellIndex *record)
+{
+  Bucket &bucket = m_open[{f, g}];
+  if (bucket.path.empty())
+  {
+    bucket.path = newFile();
+  }
+  bucket.buffer.insert(bucket.buffer.end(), record, record + m_width);
+  ++m_statistics.nodes;
+  if (bucket.buffer.size() >= g_bucketRecords * m_width)
+  {
+    flush(bucket);
+  }
+}
+
+void ExternalAStar::flush(Bucket &bucket)
+{
+  if (bucket.buffer.empty())
+  {
+    return;
+  }
+  std::ofstream file(bucket.path, std::ios::binary | std::ios::app);
+  writeRecords(file, bucket.buffer, bucket.path, m_statistics);
+  bucket.buffer.clear();
+  bucket.buffer.shrink_to_fit();
+}
+
+std::vector<std::string> ExternalAStar::sortRuns(Bucket &bucket)
+{
+  flush(bucket);
+  const size_t runRecords = std::max<size_t>(m_config.runBytes / (m_width * sizeof(CellIndex)), 1);
+  std::vector<std::string> runs;
+  {
+    RecordReader reader(bucket.path, m_width);
+    std::vector<CellIndex> chunk;
+    std::vector<const CellIndex *> order;
+    while (reader.valid())
+    {
+      chunk.clear();
+      for (size_t i = 0; i < runRecords && reader.valid(); ++i, reader.next())
+      {
+        chunk.insert(chunk.end(), reader.record(), reader.record() + m_width);
+      }
+      order.clear();
+      for (size_t i = 0; i < chunk.size(); i += m_width)
+      {
+        order.push_back(chunk.data() + i);
+      }
+      std::sort(order.begin(), order.end(),
+                [this](const CellIndex *l, const CellIndex *r) { return less(l, r); });
+
+      runs.push_back(newFile());
+      RecordWriter writer(runs.back(), m_width, m_statistics);
+      const CellIndex *previous = nullptr;
+      for (const CellIndex *record : order)
+      {
+        if (previous == nullptr || less(previous, record))
+        {
+          writer.write(record);
+          previous = record;
+        }
+      }
+      writer.close();
+    }
+  }
+  fs::remove(bucket.path);
+  return runs;
+}
+
+bool ExternalAStar::expandBucket(size_t f, size_t g, Bucket &bucket)
+{
+  const std::vector<std::string> runs = sortRuns(bucket);
+  std::vector<std::unique_ptr<RecordReader>> readers;
+  for (const std::string &run : runs)
+  {
+    readers.push_back(std::make_unique<RecordReader>(run, m_width));
+  }
+  auto greater = [&readers, this](size_t l, size_t r) {
+    return less(readers[r]->record(), readers[l]->record());
+  };
+  std::priority_queue<size_t, std::vector<size_t>, decltype(greater)> merged(greater);
+  for (size_t i = 0; i < readers.size(); ++i)
+  {
+    if (readers[i]->valid())
+    {
+      merged.push(i);
+    }
+  }
+
+  // states of the bucket in order with the closed states: each state is either new or
+  // equal to the next closed one
+  auto closed = std::make_unique<RecordReader>(m_closed, m_width);
+  const std::string nextClosed = newFile();
+  RecordWriter closedWriter(nextClosed, m_width, m_statistics);
+  std::vector<CellIndex> last;
+  bool solved = false;
+  bool stopped = false;
+  while (!merged.empty() && !solved && !stopped)
+  {
+    const size_t run = merged.top();
+    merged.pop();
+    const CellIndex *record = readers[run]->record();
+    bool duplicate = !last.empty() && !less(last.data(), record);
+    if (!duplicate)
+    {
+      last.assign(record, record + m_width);
+      while (closed->valid() && less(closed->record(), record))
+      {
+        closedWriter.write(closed->record());
+        closed->next();
+      }
+      duplicate = closed->valid() && !less(record, closed->record());
+    }
+    if (!duplicate)
+    {
+      closedWriter.write(record);
+      ++m_closedSize;
+      if (f == g)
+      {
+        // all boxes are on destinations
+        m_goal = last;
+        solved = true;
+      }
+      else
+      {
+        expand(last.data(), g);
+        stopped = m_config.maxNodes != 0 && m_statistics.nodes >= m_config.maxNodes;
+      }
+    }
+    readers[run]->next();
+    if (readers[run]->valid())
+    {
+      merged.push(run);
+    }
+  }
+
+  if (!solved)
+  {
+    for (; closed->valid(); closed->next())
+    {
+      closedWriter.write(closed->record());
+    }
+  }
+  closedWriter.close();
+  closed.reset();
+  readers.clear();
+  for (const std::string &run : runs)
+  {
+    fs::remove(run);
+  }
+  if (solved)
+  {
+    // ancestors of the goal were expanded by the previous buckets
+    fs::remove(nextClosed);
+  }
+  else
+  {
+    fs::remove(m_closed);
+    m_closed = nextClosed;
+  }
+  return solved;
+}
+
+void ExternalAStar::expand(const CellIndex *record, size_t g)
+{
+  ++m_statistics.expanded;
+  const CompactState state(record, m_stateCells);
+  m_successors.clear();
+  m_space.expand(state, m_space.hash(state), m_successors);
+  m_statistics.generated += m_successors.size();
+
+  // heuristic solves the parent again, if its assignment is evicted from the cache
+  const size_t parentKey = key(record);
+  for (const Successor &successor : m_successors)
+  {
+    if (!m_space.isValid(successor, m_mapState))
+    {
+      continue;
+    }
+    ++m_statistics.heuristicCalls;
+    const size_t childKey = ++m_lastKey;
+    const HeuristicValue h =
+        m_heuristic.evaluate(m_mapState, childKey, m_space.boxMove(parentKey, successor));
+    if (h == g_unsolvable)
+    {
+      continue;
+    }
+    makeRecord(successor.state.cells(), successor.from, successor.to, childKey);
+    const size_t childG = g + successor.cost;
+    append(childG + h, childG, m_record.data());
+  }
+}
+
+void ExternalAStar::makeRecord(const CellIndex *cells, CellIndex from, CellIndex to, size_t key)
+{
+  m_record.assign(cells, cells + m_stateCells);
+  m_record.push_back(from);
+  m_record.push_back(to);
+  m_record.resize(m_width);
+  std::memcpy(m_record.data() + m_stateCells + 2, &key, sizeof(key));
+}
+
+size_t ExternalAStar::key(const CellIndex *record) const noexcept
+{
+  size_t result;
+  std::memcpy(&result, record + m_stateCells + 2, sizeof(result));
+  return result;
+}
+
+bool ExternalAStar::findClosed(const CompactState &state, std::vector<CellIndex> &record) const
+{
+  const size_t recordBytes = m_width * sizeof(CellIndex);
+  std::ifstream file(m_closed, std::ios::binary);
+  auto read = [&](size_t index) {
+    file.seekg(static_cast<std::streamoff>(index * recordBytes));
+    file.read(reinterpret_cast<char *>(record.data()), static_cast<std::streamsize>(recordBytes));
+    if (!file)
+    {
+      throw std::runtime_error("Can't read scratch file " + m_closed);
+    }
+  };
+
+  record.resize(m_width);
+  size_t lo = 0;
+  size_t hi = fs::file_size(m_closed) / recordBytes;
+  while (lo < hi)
+  {
+    const size_t middle = (lo + hi) / 2;
+    read(middle);
+    if (less(record.data(), state.cells()))
+    {
+      lo = middle + 1;
+    }
+    else
+    {
+      hi = middle;
+    }
+  }
+  if (lo == fs::file_size(m_closed) / recordBytes)
+  {
+    return false;
+  }
+  read(lo);
+  return !less(state.cells(), record.data());
+}
+
+std::vector<BoxMovement> ExternalAStar::restorePath(std::vector<CellIndex> record)
+{
+  std::vector<BoxMovement> result;
+  while (record[m_stateCells] != g_noCell)
+  {
+    const CompactState state(record.data(), m_stateCells);
+    const CompactState parent =
+        m_space.predecessor(state, record[m_stateCells], record[m_stateCells + 1]);
+    result.push_back(restoreSingleStep(parent, state, m_space.cols()));
+    if (!findClosed(parent, record))
+    {
+      throw std::runtime_error("Parent state isn't found in " + m_closed);
+    }
+  }
+  std::reverse(result.begin(), result.end());
+  return result;
+}
+
+bool ExternalAStar::less(const CellIndex *l, const CellIndex *r) const noexcept
+{
+  // any total order of the states will do
+  return std::memcmp(l, r, m_stateCells * sizeof(CellIndex)) < 0;
+}
+
+} // namespace soko
@@ -0,0 +1,84 @@
+#pragma once
+
+#include <map>
+#include <string>
+
+#include "soko/search_space.h"
+#include "soko/solver.h"
+
+namespace soko
+{
+
+// External-memory A*: open and closed lists are files in a scratch directory, so the amount
+// of states is limited by the disk rather than memory. A state is a fixed-width record of its
+// cells (sorted boxes and the unit) followed by the cells of the push, that generated it, and
+// the heuristic key of the state: successors repair the state's assignment, while it's cached.
+// Open list is a set of bucket files by (f, g), expanded in the order of f, then g. Before the
+// expansion a bucket is split into sorted runs, which fit into SolverConfig::runBytes; the runs
+// are merged, and the merged states are compared with the sorted closed file in the same
+// sequential pass. So duplicates are removed with delayed merges instead of random lookups.
+// Solution is restored from the closed file: the parent of a state follows from its push.
+class ExternalAStar {
+public:
+  // throws std::filesystem::filesystem_error, if the scratch directory can't be created
+  ExternalAStar(SearchSpace &space, const Heuristic &heuristic, const SolverConfig &config,
+                SolverStatistics &statistics);
+  ExternalAStar(const ExternalAStar &) = delete;
+  ExternalAStar &operator=(const ExternalAStar &) = delete;
+  // Removes the scratch files
+  ~ExternalAStar();
+
+  // Returns false if there is no solution or the node limit is reached.
+  // Throws std::runtime_error if scratch files can't be written or read
+  bool solve(std::vector<BoxMovement> &result);
+
+private:
+  // Unsorted states with the same f and g; records are buffered before they are appended
+  struct Bucket
+  {
+    std::string path;
+    std::vector<CellIndex> buffer;
+  };
+
+  std::string newFile();
+  void append(size_t f, size_t g, const CellIndex *record);
+  void flush(Bucket &bucket);
+  // Sorted runs without duplicates; the bucket file is removed
+  std::vector<std::string> sortRuns(Bucket &bucket);
+  // Merges sorted runs of the bucket with the closed file. New states are expanded and stored
+  // into the new closed file. Returns true if a goal is found
+  bool expandBucket(size_t f, size_t g, Bucket &bucket);
+  void expand(const CellIndex *record, size_t g);
+  // Fills m_record
+  void makeRecord(const CellIndex *cells, CellIndex from, CellIndex to, size_t key);
+  size_t key(const CellIndex *record) const noexcept;
+  // Closed record of the state
+  bool findClosed(const CompactState &state, std::vector<CellIndex> &record) const;
+  std::vector<BoxMovement> restorePath(std::vector<CellIndex> record);
+
+  bool less(const CellIndex *l, const CellIndex *r) const noexcept;
+
+private:
+  SearchSpace &m_space;
+  const Heuristic &m_heuristic;
+  const SolverConfig &m_config;
+  SolverStatistics &m_statistics;
+
+  std::string m_directory;
+  size_t m_files = 0;
+  // record: state cells, push cells `from` and `to`, heuristic key
+  size_t m_stateCells = 0;
+  size_t m_width = 0;
+  std::map<std::pair<size_t, size_t>, Bucket> m_open;
+  std::string m_closed;
+  size_t m_closedSize = 0;
+  std::vector<CellIndex> m_goal;
+
+  // heuristic cache keys, unique for each evaluated state
+  size_t m_lastKey = 0;
+  std::vector<Successor> m_successors;
+  MapState m_mapState;
+  std::vector<CellIndex> m_record;
+};
+
+} // namespace soko
@@ -0,0 +1,133 @@
+#include "soko/greedy_search.h"
+
+#include <algorithm>
+
+namespace soko
+{
+
+GreedySearch::GreedySearch(SearchSpace &space, const Heuristic &heuristic,
+                           const SolverConfig &config, SolverStatistics &statistics)
+  : m_space(space)
+  , m_heuristic(heuristic)
+  , m_config(config)
+  , m_statistics(statistics)
+{
+  m_nodes.reset(space.root().cellCount());
+}
+
+bool GreedySearch::solve(std::vector<BoxMovement> &result)
+{
+  const NodeId root = m_nodes.allocate(g_noNode, m_space.rootHash(), m_space.root().cells());
+  m_closedSet.findOrInsert(
+      m_space.rootHash(), [](NodeId) { return false; }, [root]() { return root; });
+  ++m_statistics.heuristicCalls;
+  const HeuristicValue rootH = m_heuristic.evaluate(m_space.initialState(), root);
+  bool solved = false;
+  if (rootH == 0)
+  {
+    m_goal = root;
+    solved = true;
+  }
+  else if (rootH != g_unsolvable)
+  {
+    solved = m_config.algorithm == SearchAlgorithm::Beam ? beam(rootH) : bestFirst(rootH);
+  }
+
+  m_statistics.closedSet = m_closedSet.statistics();
+  m_statistics.nodes = m_nodes.size();
+  m_statistics.arenaBytes = m_nodes.bytesUsed();
+  if (solved)
+  {
+    result = restoreSteps(m_nodes, m_goal, m_space.cols());
+  }
+  return solved;
+}
+
+bool GreedySearch::bestFirst(HeuristicValue rootH)
+{
+  // entries are queued without g: the queue is ordered by h only
+  BucketQueue open;
+  open.push(0, 0, rootH);
+  std::vector<Child> children;
+  while (!open.empty() && !limitReached())
+  {
+    const OpenEntry entry = open.pop();
+    children.clear();
+    if (expand(entry.node, children))
+    {
+      return true;
+    }
+    for (const Child &child : children)
+    {
+      open.push(child.node, 0, child.h);
+    }
+  }
+  return false;
+}
+
+bool GreedySearch::beam(HeuristicValue rootH)
+{
+  const size_t width = std::max<size_t>(m_config.beamWidth, 1);
+  std::vector<Child> layer = {{rootH, 0}};
+  std::vector<Child> next;
+  while (!layer.empty() && !limitReached())
+  {
+    ++m_statistics.iterations;
+    next.clear();
+    for (const Child &parent : layer)
+    {
+      if (expand(parent.node, next))
+      {
+        return true;
+      }
+    }
+    if (next.size() > width)
+    {
+      // ties are kept in the order of generation
+      std::stable_sort(next.begin(), next.end(),
+                       [](const Child &l, const Child &r) { return l.h < r.h; });
+      next.resize(width);
+    }
+    layer.swap(next);
+  }
+  return false;
+}
+
+bool GreedySearch::expand(NodeId current, std::vector<Child> &children)
+{
+  ++m_statistics.expanded;
+  const uint32_t g = m_nodes.header(current).g;
+  m_successors.clear();
+  m_space.expand(m_nodes.state(current), m_nodes.header(current).hash, m_successors);
+  m_statistics.generated += m_successors.size();
+
+  for (const Successor &successor : m_successors)
+  {
+    auto inserted = m_closedSet.findOrInsert(
+        successor.hash, [&](NodeId n) { return m_nodes.equal(n, successor.state); },
+        [&]() {
+          return m_nodes.allocate(current, successor.hash, successor.state.cells(),
+                                  g + successor.cost);
+        });
+    if (!inserted.second || !m_space.isValid(successor, m_mapState))
+    {
+      continue;
+    }
+    const NodeId node = *inserted.first;
+    ++m_statistics.heuristicCalls;
+    const HeuristicValue h =
+        m_heuristic.evaluate(m_mapState, node, m_space.boxMove(current, successor));
+    if (h == 0)
+    {
+      m_goal = node;
+      return true;
+    }
+    if (h != g_unsolvable)
+    {
+      children.push_back({h, node});
+    }
+  }
+  return false;
+}
+
+} // namespace soko
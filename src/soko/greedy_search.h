@@ -0,0 +1,55 @@
+#pragma once
+
+#include "soko/node_arena.h"
+#include "soko/open_list.h"
+#include "soko/search_space.h"
+#include "soko/solver.h"
+#include "soko/transposition_table.hpp"
+
+namespace soko
+{
+
+// Fast searches, that tell whether a level is solvable rather than find a short solution.
+// Greedy best-first search expands the node with the least h; beam search expands the states
+// layer by layer and keeps SolverConfig::beamWidth successors with the least h in each layer,
+// so it may miss a solution. Every state is stored once: the first found path is kept and
+// a goal is accepted as soon as it's generated.
+class GreedySearch {
+public:
+  GreedySearch(SearchSpace &space, const Heuristic &heuristic, const SolverConfig &config,
+               SolverStatistics &statistics);
+
+  // Returns false if no solution is found or the node limit is reached
+  bool solve(std::vector<BoxMovement> &result);
+
+private:
+  struct Child
+  {
+    HeuristicValue h;
+    NodeId node;
+  };
+
+  bool bestFirst(HeuristicValue rootH);
+  bool beam(HeuristicValue rootH);
+  // Stores new valid successors of the node to `children`. Returns true if the goal is found
+  bool expand(NodeId current, std::vector<Child> &children);
+  bool limitReached() const noexcept
+  {
+    return m_config.maxNodes != 0 && m_nodes.size() >= m_config.maxNodes;
+  }
+
+private:
+  SearchSpace &m_space;
+  const Heuristic &m_heuristic;
+  const SolverConfig &m_config;
+  SolverStatistics &m_statistics;
+
+  NodeArena m_nodes;
+  TranspositionTable<NodeId> m_closedSet;
+  NodeId m_goal = g_noNode;
+
+  std::vector<Successor> m_successors;
+  MapState m_mapState;
+};
+
+} // namespace soko
@@ -0,0 +1,330 @@
+#include "soko/hda_star.h"
+
+#include <thread>
+
+namespace soko
+{
+
+namespace
+{
+
+// messages of a batch; full batch is sent immediately
+constexpr size_t g_batchSize = 64;
+// expansions between sends of partially filled batches
+constexpr size_t g_flushInterval = 64;
+// heuristic key of states, evaluated for other threads. It isn't a node id, so heuristic data
+// of such states is never looked up
+constexpr size_t g_remoteKey = g_inf;
+
+} // namespace
+
+HdaStar::Worker::Worker(const Map &map, bool tunnelMacros, std::unique_ptr<Heuristic> &&heuristic,
+                        size_t workers)
+  : space(map, false, tunnelMacros)
+  , heuristic(std::move(heuristic))
+  , outbox(workers)
+{
+  nodes.reset(space.root().cellCount());
+  for (auto &batch : outbox)
+  {
+    batch = std::make_unique<Batch>();
+  }
+}
+
+HdaStar::HdaStar(const Map &map, const Heuristic &heuristic, const SolverConfig &config,
+                 SolverStatistics &statistics)
+  : m_config(config)
+  , m_statistics(statistics)
+{
+  size_t threads = config.threads != 0 ? config.threads : std::thread::hardware_concurrency();
+  threads = std::max<size_t>(threads, 1);
+  for (size_t i = 0; i < threads; ++i)
+  {
+    m_workers.push_back(
+        std::make_unique<Worker>(map, config.tunnelMacros, heuristic.clone(), threads));
+  }
+}
+
+HdaStar::~HdaStar()
+{
+  // batches, left in flight by a stopped search
+  for (auto &worker : m_workers)
+  {
+    Batch *batch = worker->inbox.takeAll();
+    while (batch != nullptr)
+    {
+      Batch *next = batch->next;
+      delete batch;
+      batch = next;
+    }
+  }
+}
+
+bool HdaStar::solve(std::vector<BoxMovement> &result)
+{
+  const SearchSpace &space = m_workers.front()->space;
+  const size_t rootOwner = owner(space.rootHash());
+  Worker &worker = *m_workers[rootOwner];
+  const NodeId root = insert(worker, space.root(), space.rootHash(), {0, g_noNode}, 0);
+  ++worker.statistics.heuristicCalls;
+  const HeuristicValue h = worker.heuristic->evaluate(space.initialState(), root);
+  if (h == g_unsolvable)
+  {
+    return false;
+  }
+  worker.evaluated[root] = true;
+  worker.open.push(root, 0, h);
+
+  m_pending = m_workers.size();
+  std::vector<std::thread> threads;
+  for (size_t i = 1; i < m_workers.size(); ++i)
+  {
+    threads.emplace_back(&HdaStar::run, this, i);
+  }
+  run(0);
+  for (auto &thread : threads)
+  {
+    thread.join();
+  }
+
+  for (auto &w : m_workers)
+  {
+    const SolverStatistics &stats = w->statistics;
+    m_statistics.nodes += w->nodes.size();
+    m_statistics.arenaBytes += w->nodes.bytesUsed();
+    m_statistics.expanded += stats.expanded;
+    m_statistics.generated += stats.generated;
+    m_statistics.reopened += stats.reopened;
+    m_statistics.heuristicCalls += stats.heuristicCalls;
+    m_statistics.messages += stats.messages;
+    m_statistics.closedSet.merge(w->closed.statistics());
+  }
+
+  // solution, found before the node limit, may be not optimal
+  if (m_stopped || m_solution.node == g_noNode)
+  {
+    return false;
+  }
+
+  // parents of a node may belong to other threads
+  result.clear();
+  NodeRef current = m_solution;
+  while (true)
+  {
+    const Worker &child = *m_workers[current.worker];
+    const NodeId parent = child.nodes.header(current.node).parent;
+    if (parent == g_noNode)
+    {
+      break;
+    }
+    NodeRef previous = {child.parentWorkers[current.node], parent};
+    result.push_back(restoreSingleStep(m_workers[previous.worker]->nodes.state(previous.node),
+                                       child.nodes.state(current.node), space.cols()));
+    current = previous;
+  }
+  std::reverse(result.begin(), result.end());
+  return true;
+}
+
+void HdaStar::run(size_t index)
+{
+  Worker &worker = *m_workers[index];
+  bool active = true;
+  size_t expansions = 0;
+  while (!m_stopped.load(std::memory_order_relaxed))
+  {
+    Batch *batch = worker.inbox.takeAll();
+    if (batch != nullptr && !active)
+    {
+      // counted before the batch is released, so the pending count doesn't drop to zero
+      ++m_pending;
+      active = true;
+    }
+    while (batch != nullptr)
+    {
+      for (const Message &message : batch->messages)
+      {
+        receive(worker, message);
+      }
+      Batch *next = batch->next;
+      delete batch;
+      batch = next;
+      --m_pending;
+    }
+
+    if (!worker.open.empty())
+    {
+      const OpenEntry entry = worker.open.pop();
+      if (entry.g != worker.nodes.header(entry.node).g ||
+          entry.f() >= m_bestG.load(std::memory_order_relaxed))
+      {
+        // reopened with fewer pushes or can't improve the found solution
+        continue;
+      }
+      if (entry.h == 0)
+      {
+        updateSolution(index, entry.node, entry.g);
+        continue;
+      }
+      expand(index, entry);
+      if (++expansions % g_flushInterval == 0)
+      {
+        flush(worker);
+      }
+      continue;
+    }
+
+    flush(worker);
+    if (active)
+    {
+      active = false;
+      --m_pending;
+    }
+    if (m_pending == 0)
+    {
+      break;
+    }
+    std::this_thread::yield();
+  }
+}
+
+void HdaStar::receive(Worker &worker, const Message &message)
+{
+  if (message.g + message.h >= m_bestG.load(std::memory_order_relaxed))
+  {
+    return;
+  }
+  const NodeId node = insert(worker, message.state, message.hash, message.parent, message.g);
+  if (node != g_noNode)
+  {
+    worker.open.push(node, message.g, message.h);
+  }
+}
+
+void HdaStar::expand(size_t index, const OpenEntry &entry)
+{
+  Worker &worker = *m_workers[index];
+  NodeArena &nodes = worker.nodes;
+  const size_t cols = worker.space.cols();
+  const NodeId current = entry.node;
+  const CompactState state = nodes.state(current);
+  if (!worker.evaluated[current])
+  {
+    // node came from another thread: successors are evaluated faster, when the heuristic
+    // has data of the parent
+    ++worker.statistics.heuristicCalls;
+    worker.heuristic->evaluate(state.toMapState(cols), current);
+    worker.evaluated[current] = true;
+  }
+
+  ++worker.statistics.expanded;
+  worker.successors.clear();
+  worker.space.expand(state, nodes.header(current).hash, worker.successors);
+  worker.statistics.generated += worker.successors.size();
+
+  const NodeRef parent = {static_cast<uint32_t>(index), current};
+  for (const Successor &successor : worker.successors)
+  {
+    if (!worker.space.isValid(successor, worker.mapState))
+    {
+      continue;
+    }
+    const uint32_t g = static_cast<uint32_t>(entry.g + successor.cost);
+    const BoxMove move = worker.space.boxMove(current, successor);
+    const size_t to = owner(successor.hash);
+    if (to == index)
+    {
+      const NodeId node = insert(worker, successor.state, successor.hash, parent, g);
+      if (node == g_noNode)
+      {
+        continue;
+      }
+      ++worker.statistics.heuristicCalls;
+      const HeuristicValue h = worker.heuristic->evaluate(worker.mapState, node, move);
+      worker.evaluated[node] = true;
+      if (h != g_unsolvable)
+      {
+        worker.open.push(node, g, h);
+      }
+      continue;
+    }
+
+    ++worker.statistics.heuristicCalls;
+    const HeuristicValue h = worker.heuristic->evaluate(worker.mapState, g_remoteKey, move);
+    if (h == g_unsolvable || g + h >= m_bestG.load(std::memory_order_relaxed))
+    {
+      continue;
+    }
+    auto &messages = worker.outbox[to]->messages;
+    messages.push_back({successor.state, successor.hash, parent, g, h});
+    ++worker.statistics.messages;
+    if (messages.size() >= g_batchSize)
+    {
+      send(worker, to);
+    }
+  }
+}
+
+NodeId HdaStar::insert(Worker &worker, const CompactState &state, StateHash hash, NodeRef parent,
+                       uint32_t g)
+{
+  NodeArena &nodes = worker.nodes;
+  auto inserted = worker.closed.findOrInsert(
+      hash, [&](NodeId n) { return nodes.equal(n, state); },
+      [&]() { return nodes.allocate(parent.node, hash, state.cells(), g); });
+  const NodeId node = *inserted.first;
+  if (inserted.second)
+  {
+    worker.parentWorkers.push_back(parent.worker);
+    worker.evaluated.push_back(false);
+    if (m_config.maxNodes != 0 && ++m_nodes >= m_config.maxNodes)
+    {
+      m_stopped = true;
+    }
+    return node;
+  }
+
+  NodeHeader &header = nodes.header(node);
+  if (!m_config.reopenNodes || header.g <= g)
+  {
+    return g_noNode;
+  }
+  header.g = g;
+  header.parent = parent.node;
+  worker.parentWorkers[node] = parent.worker;
+  ++worker.statistics.reopened;
+  return node;
+}
+
+void HdaStar::send(Worker &worker, size_t to)
+{
+  auto &batch = worker.outbox[to];
+  // counted before the push: receiver may process the batch at once
+  ++m_pending;
+  m_workers[to]->inbox.push(batch.release());
+  batch = std::make_unique<Batch>();
+  batch->messages.reserve(g_batchSize);
+}
+
+void HdaStar::flush(Worker &worker)
+{
+  for (size_t to = 0; to < worker.outbox.size(); ++to)
+  {
+    if (!worker.outbox[to]->messages.empty())
+    {
+      send(worker, to);
+    }
+  }
+}
+
+void HdaStar::updateSolution(size_t index, NodeId node, size_t g)
+{
+  std::lock_guard<std::mutex> lock(m_solutionMutex);
+  if (g < m_bestG)
+  {
+    m_bestG = g;
+    m_solution = {static_cast<uint32_t>(index), node};
+  }
+}
+
+} // namespace soko
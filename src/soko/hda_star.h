@@ -0,0 +1,108 @@
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+
+#include "soko/mpsc_queue.hpp"
+#include "soko/node_arena.h"
+#include "soko/open_list.h"
+#include "soko/search_space.h"
+#include "soko/solver.h"
+#include "soko/transposition_table.hpp"
+
+namespace soko
+{
+
+// Hash distributed A*: every thread owns the states, which hash maps to it, and keeps their
+// nodes, closed set and open list. Successors of other threads are evaluated by the generating
+// thread and sent to the owner in batches through lock-free queues.
+// The first found solution isn't necessarily optimal: threads continue, until every node with
+// f below the best solution is expanded. The search is finished, when all threads are idle and
+// no batch is in flight.
+class HdaStar {
+public:
+  // Every thread gets its own search space of the map and a copy of the heuristic
+  HdaStar(const Map &map, const Heuristic &heuristic, const SolverConfig &config,
+          SolverStatistics &statistics);
+  ~HdaStar();
+
+  // Returns false if there is no solution or the node limit is reached
+  bool solve(std::vector<BoxMovement> &result);
+
+private:
+  // node of some thread
+  struct NodeRef
+  {
+    uint32_t worker;
+    NodeId node;
+  };
+
+  struct Message
+  {
+    CompactState state;
+    StateHash hash;
+    NodeRef parent;
+    uint32_t g;
+    HeuristicValue h;
+  };
+
+  struct Batch
+  {
+    Batch *next = nullptr;
+    std::vector<Message> messages;
+  };
+
+  struct Worker
+  {
+    Worker(const Map &map, bool tunnelMacros, std::unique_ptr<Heuristic> &&heuristic,
+           size_t workers);
+
+    SearchSpace space;
+    std::unique_ptr<Heuristic> heuristic;
+    NodeArena nodes;
+    // thread of the node's parent; parent node id is kept in the node header
+    std::vector<uint32_t> parentWorkers;
+    // node was evaluated by this thread, so its heuristic data is cached here
+    std::vector<bool> evaluated;
+    TranspositionTable<NodeId> closed;
+    BucketQueue open;
+
+    MpscQueue<Batch> inbox;
+    // batches, being filled for other threads
+    std::vector<std::unique_ptr<Batch>> outbox;
+    SolverStatistics statistics;
+
+    std::vector<Successor> successors;
+    MapState mapState;
+  };
+
+  size_t owner(StateHash hash) const noexcept { return (hash >> 32) % m_workers.size(); }
+
+  void run(size_t index);
+  void receive(Worker &worker, const Message &message);
+  void expand(size_t index, const OpenEntry &entry);
+  // Inserts the node or reopens it with fewer pushes. Returns g_noNode if there is nothing to do
+  NodeId insert(Worker &worker, const CompactState &state, StateHash hash, NodeRef parent,
+                uint32_t g);
+  void send(Worker &worker, size_t to);
+  void flush(Worker &worker);
+  void updateSolution(size_t index, NodeId node, size_t g);
+
+private:
+  const SolverConfig &m_config;
+  SolverStatistics &m_statistics;
+  std::vector<std::unique_ptr<Worker>> m_workers;
+
+  // active threads and batches in flight; the search is over, when nothing remains
+  std::atomic<size_t> m_pending{0};
+  std::atomic<size_t> m_nodes{0};
+  std::atomic<bool> m_stopped{false};
+
+  // pushes of the best found solution
+  std::atomic<size_t> m_bestG{g_inf};
+  std::mutex m_solutionMutex;
+  NodeRef m_solution = {0, g_noNode};
+};
+
+} // namespace soko
@@ -2,8 +2,13 @@
 #include "soko/move.h"
 #include "soko/util.h"
 #include "soko/hungarian_algo.h"
+#include "soko/pattern_database.h"
+#include "soko/reachability.h"
 #include <queue>
 #include <array>
+#include <map>
+#include <cstdint>
+#include <limits>
 
 namespace soko
 {
@@ -13,6 +18,27 @@ namespace
 
 constexpr std::array<Move, 4> g_moves = {Move::Left, Move::Right, Move::Up, Move::Down};
 
+// Marks of HungarianHeuristic::m_boxCells
+constexpr uint8_t g_noBox = 0;
+constexpr uint8_t g_box = 1;
+constexpr uint8_t g_checkedBox = 2;
+// Pushes of a box on its destination, which has to leave it: away and back again
+constexpr size_t g_leavePushes = 2;
+
+// Distance of the table: box can't reach the destination
+constexpr uint16_t g_noDistance = std::numeric_limits<uint16_t>::max();
+
+inline size_t toCost(uint16_t distance) noexcept
+{
+  return distance == g_noDistance ? g_inf : distance;
+}
+
+inline HeuristicValue toHeuristicValue(size_t cost) noexcept
+{
+  assert(cost == g_inf || cost < g_unsolvable); // no overflow happened
+  return cost == g_inf ? g_unsolvable : static_cast<HeuristicValue>(cost);
+}
+
 Mat<size_t> createDistanceMat(const MapStatic &m, const Pos from)
 {
   Mat<size_t> result(std::vector<size_t>(m.rows() * m.cols(), g_inf), m.cols());
@@ -42,10 +68,9 @@ Mat<size_t> createDistanceMat(const MapStatic &m, const Pos from)
   return result;
 }
 
-Mat<size_t> createExtendedDistanceMat(const MapStatic &m, const Pos from)
+// Box at newPos is pulled to cur, if the unit can step back from cur
+Mat<size_t> createPullDistanceMat(const MapStatic &m, const Pos from)
 {
-  // TODO: add real box movement by unit
-  // TODO: create soko solver engine
   Mat<size_t> result(std::vector<size_t>(m.rows() * m.cols(), g_inf), m.cols());
 
   result.at(from) = 0;
@@ -58,9 +83,9 @@ Mat<size_t> createExtendedDistanceMat(const MapStatic &m, const Pos from)
     observe.pop();
     for (auto move : g_moves)
     {
-      Pos fromPos = cur - move;
       Pos newPos = cur + move;
-      if (m.safeIsFree(fromPos) && result.contains(newPos) && result.at(newPos) == g_inf &&
+      Pos unitPos = cur - move;
+      if (m.safeIsFree(unitPos) && result.contains(newPos) && result.at(newPos) == g_inf &&
           m.isFree(newPos))
       {
         result.at(newPos) = result.at(cur) + 1;
@@ -72,43 +97,204 @@ Mat<size_t> createExtendedDistanceMat(const MapStatic &m, const Pos from)
   return result;
 }
 
-class HungarianHeuristic : public Heuristic {
+// Push distances of a box, moved by the unit, which walks round the box. The state of the
+// search is the box cell and the side of the box, the unit stands at: the unit can push from
+// another side only if it walks there without moving the box. Other boxes are ignored, so
+// distances are a lower bound of pushes, and never less than createDistanceMat ones
+class PushDistances {
 public:
-  using ShortestPathsPos = Mat<size_t>;
-  using ShortestPaths = std::pair<Pos, ShortestPathsPos>;
+  explicit PushDistances(const MapStatic &m)
+    : m_reach(m)
+    , m_cols(m.cols())
+    , m_zones(m_reach.cells() * g_moves.size(), g_noCell)
+  {
+    for (CellIndex box = 0; box < m_reach.cells(); ++box)
+    {
+      if (!m.isFree(toPos(box, m_cols)))
+      {
+        continue;
+      }
+      m_reach.setBoxes(&box, 1);
+      CellIndex *zones = m_zones.data() + box * g_moves.size();
+      for (size_t s = 0; s < g_moves.size(); ++s)
+      {
+        const CellIndex side = m_reach.neighbour(box, g_moves[s]);
+        if (side == g_noCell || zones[s] != g_noCell)
+        {
+          continue;
+        }
+        // normalized unit position identifies the area around the box
+        const CellIndex zone = m_reach.fill(side);
+        for (size_t other = s; other < g_moves.size(); ++other)
+        {
+          const CellIndex otherSide = m_reach.neighbour(box, g_moves[other]);
+          if (otherSide != g_noCell && m_reach.isReachable(otherSide))
+          {
+            zones[other] = zone;
+          }
+        }
+      }
+    }
+  }
+
+  // Least pushes of the box from each cell to the destination with the unit at the best side.
+  // Breadth-first pull search from the destination: box is pulled from `cur` to the cell of
+  // the unit, the unit steps back in the same direction
+  Mat<size_t> create(Pos destination) const
+  {
+    std::vector<size_t> sides(m_zones.size(), g_inf);
+    std::queue<size_t> observe;
+    const CellIndex from = toCellIndex(destination, m_cols);
+    for (size_t s = 0; s < g_moves.size(); ++s)
+    {
+      if (m_reach.neighbour(from, g_moves[s]) != g_noCell)
+      {
+        sides[from * g_moves.size() + s] = 0;
+        observe.push(from * g_moves.size() + s);
+      }
+    }
+    while (!observe.empty())
+    {
+      const size_t state = observe.front();
+      observe.pop();
+      const CellIndex cur = static_cast<CellIndex>(state / g_moves.size());
+      const size_t s = state % g_moves.size();
+      // the unit, which pushed the box to cur, stands at `box` and came from `unit`
+      const CellIndex box = m_reach.neighbour(cur, g_moves[s]);
+      const CellIndex unit = m_reach.neighbour(box, g_moves[s]);
+      if (unit == g_noCell)
+      {
+        continue;
+      }
+      // before the push the unit could walk to `unit` from any side of its area
+      const CellIndex *zones = m_zones.data() + box * g_moves.size();
+      for (size_t other = 0; other < g_moves.size(); ++other)
+      {
+        const size_t previous = box * g_moves.size() + other;
+        if (zones[other] == zones[s] && sides[previous] == g_inf)
+        {
+          sides[previous] = sides[state] + 1;
+          observe.push(previous);
+        }
+      }
+    }
+
+    Mat<size_t> result(std::vector<size_t>(m_reach.cells(), g_inf), m_cols);
+    for (size_t state = 0; state < sides.size(); ++state)
+    {
+      size_t &distance = *(result.begin() + state / g_moves.size());
+      distance = std::min(distance, sides[state]);
+    }
+    return result;
+  }
+
+private:
+  Reachability m_reach;
+  size_t m_cols = 0;
+  // areas of the unit by box cell and side: sides with the same area are connected
+  std::vector<CellIndex> m_zones;
+};
 
-  HungarianHeuristic(bool extendedDistance) noexcept
-    : m_extendedDistance(extendedDistance)
+class HungarianHeuristic : public Heuristic {
+public:
+  HungarianHeuristic(HeuristicType distance) noexcept
+    : m_distance(distance)
   {}
   virtual void init(const Map &m) noexcept override;
-  virtual std::string name() const noexcept override { return "Hungarian"; }
+  virtual std::string name() const noexcept override
+  {
+    return penalties() ? "Hungarian+penalties" : "Hungarian";
+  }
+  virtual std::unique_ptr<Heuristic> clone() const override;
 
-  virtual size_t operator()(const MapState &boxes) const noexcept override;
+  virtual HeuristicValue operator()(const MapState &boxes) const noexcept override;
+  virtual HeuristicValue evaluate(const MapState &state, size_t key) const noexcept override;
+  // Repairs the assignment of the parent, if it's cached
+  virtual HeuristicValue evaluate(const MapState &state, size_t key,
+                                  const BoxMove &move) const noexcept override;
+  // Sum of distances to the nearest destination
+  virtual HeuristicValue lowerBound(const MapState &state) const noexcept override;
+  // Bound by the parent's dual potentials: only the row of the moved box changes
+  virtual HeuristicValue lowerBound(const MapState &state,
+                                    const BoxMove &move) const noexcept override;
+  // Push distances ignore other boxes
+  virtual bool admissible() const noexcept override { return true; }
+  virtual size_t bytes() const noexcept override
+  {
+    return (m_distances.size() + m_nearestDestination.size()) * sizeof(uint16_t);
+  }
 
 private:
-  const bool m_extendedDistance;
-  std::vector<ShortestPaths> m_destinationsPaths;
+  // Solved assignments of recent states, direct mapped by key. Rows are boxes of the entry
+  struct CacheEntry
+  {
+    size_t key = g_inf;
+    std::vector<Pos> boxes;
+    IncrementalAssignment::Duals duals;
+  };
+
+  size_t cellIndex(Pos cell) const noexcept { return cell.i * m_map.cols() + cell.j; }
+  // Distances of the cell to each destination
+  const uint16_t *distances(Pos cell) const noexcept
+  {
+    return m_distances.data() + cellIndex(cell) * m_destinations;
+  }
+  Mat<size_t> costs(const std::vector<Pos> &boxes) const;
+  HeuristicValue store(size_t key, const std::vector<Pos> &boxes) const;
+  // Cached assignment of the parent of the state; evicted one is solved again
+  const CacheEntry &parentEntry(const MapState &state, const BoxMove &move) const;
+
+  bool penalties() const noexcept { return m_distance == HeuristicType::HungarianPenalties; }
+  // Assignment with the penalties, if they apply to the state, or `assignment` itself.
+  // Frozen box never moves again: off destination it makes the state unsolvable, on
+  // destination it's excluded from the assignment with its destination, and the others go
+  // round it. Box on destination, which is the only obstacle of a box in a corridor, leaves
+  // and comes back: at least 2 pushes to its own destination.
+  // `assigned` are boxes of the solved m_assignment, if it's the assignment of the state
+  HeuristicValue penalize(const MapState &state, HeuristicValue assignment,
+                          const std::vector<Pos> *assigned = nullptr) const;
+  // Boxes, which freeze is being checked, count as walls
+  bool frozen(Pos box) const;
+  bool axisBlocked(Pos box, Move move) const;
+  // Distance table with the frozen boxes as walls
+  const std::vector<uint16_t> &detours(const std::vector<Pos> &frozen) const;
+
+private:
+  const HeuristicType m_distance;
+  // Cell-major table: distances of a cell to all destinations are adjacent, so the costs of
+  // a box are read from a single row
+  size_t m_destinations = 0;
+  std::vector<uint16_t> m_distances;
+  std::vector<uint16_t> m_nearestDestination;
+  std::vector<Pos> m_destinationCells;
 
   mutable HungarianAlgo m_algo;
+
+  // penalties: boxes of the evaluated state by cell and distance tables by frozen boxes
+  mutable std::vector<uint8_t> m_boxCells;
+  static constexpr size_t g_detourCacheSize = 64;
+  mutable std::map<std::vector<Pos>, std::vector<uint16_t>> m_detours;
+
+  static constexpr size_t g_cacheSize = 4096;
+  mutable std::vector<CacheEntry> m_cache;
+  mutable IncrementalAssignment m_assignment;
 };
 
-std::vector<HungarianHeuristic::ShortestPaths> createDestinationMat(const MapStatic &m,
-                                                                    bool extended)
+Mat<size_t> createDestinationMat(const MapStatic &m, Pos destination, HeuristicType distance)
 {
-  std::vector<HungarianHeuristic::ShortestPaths> result;
-  for (size_t i = 0; i < m.rows(); ++i)
+  switch (distance)
   {
-    for (size_t j = 0; j < m.cols(); ++j)
-    {
-      if (m.at(i, j) == Cell::Destination)
-      {
-        Pos cur = {i, j};
-        auto distanceMap = extended ? createExtendedDistanceMat(m, cur) : createDistanceMat(m, cur);
-        result.push_back({cur, std::move(distanceMap)});
-      }
-    }
+  case HeuristicType::HungarianTaxicab:
+  case HeuristicType::HungarianPatternDatabase:
+  case HeuristicType::HungarianPenalties:
+    return createDistanceMat(m, destination);
+  case HeuristicType::HungarianTaxicabPush:
+    return PushDistances(m).create(destination);
+  case HeuristicType::HungarianPull:
+    return createPullDistanceMat(m, destination);
   }
-  return result;
+  assert(false);
+  return {};
 }
 
 size_t sumElems(const Mat<size_t> &m, const std::vector<size_t> &p)
@@ -116,6 +302,11 @@ size_t sumElems(const Mat<size_t> &m, const std::vector<size_t> &p)
   size_t result = 0;
   for (size_t i = 0; i < p.size(); ++i)
   {
+    if (m.at(i, p[i]) == g_inf)
+    {
+      // boxes can't be matched with destinations
+      return g_inf;
+    }
     result += m.at(i, p[i]);
   }
   return result;
@@ -125,47 +316,461 @@ size_t sumElems(const Mat<size_t> &m, const std::vector<size_t> &p)
 void HungarianHeuristic::init(const Map &m) noexcept
 {
   Heuristic::init(m);
-  m_destinationsPaths = createDestinationMat(m_map, m_extendedDistance);
+  m_cache.assign(g_cacheSize, {});
+  std::vector<Pos> destinations;
+  for (size_t i = 0; i < m_map.rows(); ++i)
+  {
+    for (size_t j = 0; j < m_map.cols(); ++j)
+    {
+      if (m_map.at(i, j) == Cell::Destination)
+      {
+        destinations.push_back({i, j});
+      }
+    }
+  }
+
+  const size_t cells = m_map.rows() * m_map.cols();
+  m_destinationCells = destinations;
+  m_boxCells.assign(cells, g_noBox);
+  m_detours.clear();
+  m_destinations = destinations.size();
+  m_distances.assign(cells * m_destinations, g_noDistance);
+  m_nearestDestination.assign(cells, g_noDistance);
+  // areas around the boxes are shared by the tables of all destinations
+  std::unique_ptr<PushDistances> pushDistances;
+  if (m_distance == HeuristicType::HungarianTaxicabPush)
+  {
+    pushDistances = std::make_unique<PushDistances>(m_map);
+  }
+  for (size_t j = 0; j < m_destinations; ++j)
+  {
+    const Mat<size_t> paths = pushDistances
+                                  ? pushDistances->create(destinations[j])
+                                  : createDestinationMat(m_map, destinations[j], m_distance);
+    for (size_t cell = 0; cell < cells; ++cell)
+    {
+      const size_t distance = *(paths.begin() + cell);
+      if (distance != g_inf)
+      {
+        // map cells are indexed by 16 bits, so are distances
+        m_distances[cell * m_destinations + j] = static_cast<uint16_t>(distance);
+        m_nearestDestination[cell] =
+            std::min(m_nearestDestination[cell], static_cast<uint16_t>(distance));
+      }
+    }
+  }
 }
 
-size_t HungarianHeuristic::operator()(const MapState &state) const noexcept
+std::unique_ptr<Heuristic> HungarianHeuristic::clone() const
 {
-  auto &boxes = state.boxes;
-  assert(boxes.size() == m_destinationsPaths.size());
-
-  std::vector<size_t> resultVec;
-  resultVec.reserve(boxes.size() * boxes.size());
+  auto result = std::make_unique<HungarianHeuristic>(m_distance);
+  result->m_map = m_map;
+  result->m_inited = m_inited;
+  result->m_destinations = m_destinations;
+  result->m_distances = m_distances;
+  result->m_nearestDestination = m_nearestDestination;
+  result->m_destinationCells = m_destinationCells;
+  result->m_boxCells.assign(m_boxCells.size(), g_noBox);
+  result->m_cache.assign(m_cache.size(), {});
+  return result;
+}
 
+Mat<size_t> HungarianHeuristic::costs(const std::vector<Pos> &boxes) const
+{
+  Mat<size_t> result(boxes.size(), m_destinations);
+  auto cost = result.begin();
   for (auto box : boxes)
   {
-    [[maybe_unused]] auto min = g_inf;
-    for (auto dest : m_destinationsPaths)
+    cost = std::transform(distances(box), distances(box) + m_destinations, cost, toCost);
+  }
+  return result;
+}
+
+HeuristicValue HungarianHeuristic::store(size_t key, const std::vector<Pos> &boxes) const
+{
+  CacheEntry &entry = m_cache[key % g_cacheSize];
+  entry.key = key;
+  entry.boxes = boxes;
+  entry.duals = m_assignment.duals();
+  return toHeuristicValue(m_assignment.cost());
+}
+
+HeuristicValue HungarianHeuristic::evaluate(const MapState &state, size_t key) const noexcept
+{
+  m_assignment.solve(costs(state.boxes));
+  return penalize(state, store(key, state.boxes), &state.boxes);
+}
+
+const HungarianHeuristic::CacheEntry &
+HungarianHeuristic::parentEntry(const MapState &state, const BoxMove &move) const
+{
+  const CacheEntry &parent = m_cache[move.parentKey % g_cacheSize];
+  if (parent.key != move.parentKey)
+  {
+    // parent's assignment was evicted: it's solved again once for all its successors
+    std::vector<Pos> parentBoxes = state.boxes;
+    *std::find(parentBoxes.begin(), parentBoxes.end(), move.to) = move.from;
+    m_assignment.solve(costs(parentBoxes));
+    store(move.parentKey, parentBoxes);
+  }
+  return parent;
+}
+
+HeuristicValue HungarianHeuristic::evaluate(const MapState &state, size_t key,
+                                            const BoxMove &move) const noexcept
+{
+  const CacheEntry &parent = parentEntry(state, move);
+  std::vector<Pos> boxes = parent.boxes;
+  auto moved = std::find(boxes.begin(), boxes.end(), move.from);
+  assert(moved != boxes.end());
+  *moved = move.to;
+  m_assignment.repair(costs(boxes), parent.duals, static_cast<size_t>(moved - boxes.begin()));
+  return penalize(state, store(key, boxes), &boxes);
+}
+
+HeuristicValue HungarianHeuristic::lowerBound(const MapState &state) const noexcept
+{
+  HeuristicValue result = 0;
+  for (auto box : state.boxes)
+  {
+    uint16_t distance = m_nearestDestination[cellIndex(box)];
+    if (distance == g_noDistance)
     {
-      resultVec.push_back(dest.second.at(box));
-      min = std::min(min, dest.second.at(box));
+      return g_unsolvable;
     }
-    // One of boxes can't reach any destination. This condition should be caught earlier.
-    assert(min != g_inf);
+    result += distance;
+  }
+  return result;
+}
+
+HeuristicValue HungarianHeuristic::lowerBound(const MapState &state,
+                                              const BoxMove &move) const noexcept
+{
+  const CacheEntry &parent = parentEntry(state, move);
+  auto moved = std::find(parent.boxes.begin(), parent.boxes.end(), move.from);
+  assert(moved != parent.boxes.end());
+  std::vector<size_t> rowCosts(m_destinations);
+  std::transform(distances(move.to), distances(move.to) + m_destinations, rowCosts.begin(), toCost);
+  return toHeuristicValue(IncrementalAssignment::repairBound(
+      parent.duals, static_cast<size_t>(moved - parent.boxes.begin()), rowCosts));
+}
+
+HeuristicValue HungarianHeuristic::operator()(const MapState &state) const noexcept
+{
+  auto &boxes = state.boxes;
+  assert(boxes.size() == m_destinations);
+  // One of boxes can't reach any destination. Push distances know more dead cells, than the
+  // solver does
+  if (std::any_of(boxes.begin(), boxes.end(), [this](Pos box) {
+        return m_nearestDestination[cellIndex(box)] == g_noDistance;
+      }))
+  {
+    return g_unsolvable;
   }
 
-  Mat<size_t> resultMat(std::move(resultVec), boxes.size());
+  Mat<size_t> resultMat = costs(boxes);
 
   auto resultArr = m_algo.solve(resultMat);
-  size_t result = sumElems(resultMat, resultArr);
-  assert(result < g_inf / 100); // we need this result to be sured that no overflow happened
+  return penalize(state, toHeuristicValue(sumElems(resultMat, resultArr)));
+}
+
+bool HungarianHeuristic::axisBlocked(Pos box, Move move) const
+{
+  const std::array<Pos, 2> sides = {box + move, box - move};
+  for (Pos side : sides)
+  {
+    if (m_map.safeIsWall(side) || m_boxCells[cellIndex(side)] == g_checkedBox)
+    {
+      return true;
+    }
+  }
+  for (Pos side : sides)
+  {
+    if (m_boxCells[cellIndex(side)] == g_box && frozen(side))
+    {
+      return true;
+    }
+  }
+  return false;
+}
+
+bool HungarianHeuristic::frozen(Pos box) const
+{
+  uint8_t &mark = m_boxCells[cellIndex(box)];
+  mark = g_checkedBox;
+  const bool result = axisBlocked(box, Move::Left) && axisBlocked(box, Move::Up);
+  mark = g_box;
   return result;
 }
 
+const std::vector<uint16_t> &HungarianHeuristic::detours(const std::vector<Pos> &frozen) const
+{
+  auto found = m_detours.find(frozen);
+  if (found != m_detours.end())
+  {
+    return found->second;
+  }
+  if (m_detours.size() == g_detourCacheSize)
+  {
+    m_detours.clear();
+  }
+
+  MapStatic walled = m_map;
+  for (Pos box : frozen)
+  {
+    walled.at(box) = Cell::Wall;
+  }
+  std::vector<uint16_t> result(m_distances.size(), g_noDistance);
+  for (size_t j = 0; j < m_destinations; ++j)
+  {
+    if (walled.isWall(m_destinationCells[j]))
+    {
+      continue;
+    }
+    const Mat<size_t> paths = createDistanceMat(walled, m_destinationCells[j]);
+    for (size_t cell = 0; cell * m_destinations < result.size(); ++cell)
+    {
+      const size_t distance = *(paths.begin() + cell);
+      if (distance != g_inf)
+      {
+        result[cell * m_destinations + j] = static_cast<uint16_t>(distance);
+      }
+    }
+  }
+  return m_detours.emplace(frozen, std::move(result)).first->second;
+}
+
+HeuristicValue HungarianHeuristic::penalize(const MapState &state, HeuristicValue assignment,
+                                            const std::vector<Pos> *assigned) const
+{
+  if (!penalties() || assignment == g_unsolvable)
+  {
+    return assignment;
+  }
+  const auto &boxes = state.boxes;
+  for (Pos box : boxes)
+  {
+    m_boxCells[cellIndex(box)] = g_box;
+  }
+
+  std::vector<Pos> frozenBoxes;
+  std::vector<bool> leaves(boxes.size());
+  bool unsolvable = false;
+  for (Pos box : boxes)
+  {
+    if (frozen(box))
+    {
+      frozenBoxes.push_back(box);
+      unsolvable = unsolvable || !m_map.isDestination(box);
+    }
+  }
+  for (size_t i = 0; i < boxes.size() && !unsolvable; ++i)
+  {
+    const Pos box = boxes[i];
+    if (m_map.isDestination(box) ||
+        std::find(frozenBoxes.begin(), frozenBoxes.end(), box) != frozenBoxes.end())
+    {
+      continue;
+    }
+    // corridor: the box moves only along the other axis, while a box on destination is there
+    for (auto [wallAxis, otherAxis] : {std::pair(Move::Left, Move::Up),
+                                       std::pair(Move::Up, Move::Left)})
+    {
+      if (!m_map.safeIsWall(box + wallAxis) && !m_map.safeIsWall(box - wallAxis))
+      {
+        continue;
+      }
+      for (Pos side : {box + otherAxis, box - otherAxis})
+      {
+        if (m_map.safeIsDestination(side) && m_boxCells[cellIndex(side)] == g_box)
+        {
+          leaves[std::find(boxes.begin(), boxes.end(), side) - boxes.begin()] = true;
+        }
+      }
+    }
+  }
+  for (Pos box : boxes)
+  {
+    m_boxCells[cellIndex(box)] = g_noBox;
+  }
+  if (unsolvable)
+  {
+    return g_unsolvable;
+  }
+  if (frozenBoxes.empty() && std::find(leaves.begin(), leaves.end(), true) == leaves.end())
+  {
+    return assignment;
+  }
+
+  if (assigned && frozenBoxes.empty())
+  {
+    // only the own destinations of leaving boxes cost more: a row at a time is repaired
+    Mat<size_t> penalized = costs(*assigned);
+    for (size_t i = 0; i < boxes.size(); ++i)
+    {
+      if (leaves[i])
+      {
+        const size_t row = std::find(assigned->begin(), assigned->end(), boxes[i]) -
+                           assigned->begin();
+        const size_t col = std::find(m_destinationCells.begin(), m_destinationCells.end(),
+                                     boxes[i]) -
+                           m_destinationCells.begin();
+        penalized.at(row, col) = g_leavePushes;
+        const IncrementalAssignment::Duals duals = m_assignment.duals();
+        m_assignment.repair(penalized, duals, row);
+      }
+    }
+    return std::max(assignment, toHeuristicValue(m_assignment.cost()));
+  }
+
+  // frozen boxes and their destinations are left out
+  std::sort(frozenBoxes.begin(), frozenBoxes.end());
+  const std::vector<uint16_t> &table = frozenBoxes.empty() ? m_distances : detours(frozenBoxes);
+  auto isFrozen = [&frozenBoxes](Pos box) {
+    return std::binary_search(frozenBoxes.begin(), frozenBoxes.end(), box);
+  };
+  if (assigned && std::find(leaves.begin(), leaves.end(), true) == leaves.end())
+  {
+    // costs only grow, so the assignment stays optimal, if its own costs are kept: frozen
+    // boxes are assigned to their destinations and other boxes don't go round them
+    const std::vector<size_t> destinations = m_assignment.assignment();
+    bool kept = true;
+    for (size_t r = 0; r < assigned->size() && kept; ++r)
+    {
+      const Pos box = (*assigned)[r];
+      const size_t j = destinations[r];
+      kept = isFrozen(box) ? m_destinationCells[j] == box
+                           : table[cellIndex(box) * m_destinations + j] ==
+                                 m_distances[cellIndex(box) * m_destinations + j];
+    }
+    if (kept)
+    {
+      return assignment;
+    }
+  }
+
+  std::vector<size_t> rows;
+  std::vector<size_t> cols;
+  for (size_t i = 0; i < boxes.size(); ++i)
+  {
+    if (!isFrozen(boxes[i]))
+    {
+      rows.push_back(i);
+    }
+  }
+  for (size_t j = 0; j < m_destinations; ++j)
+  {
+    if (!isFrozen(m_destinationCells[j]))
+    {
+      cols.push_back(j);
+    }
+  }
+  if (rows.empty())
+  {
+    return 0;
+  }
+  Mat<size_t> penalized(rows.size(), cols.size());
+  for (size_t r = 0; r < rows.size(); ++r)
+  {
+    const Pos box = boxes[rows[r]];
+    for (size_t c = 0; c < cols.size(); ++c)
+    {
+      size_t cost = toCost(table[cellIndex(box) * m_destinations + cols[c]]);
+      if (leaves[rows[r]] && m_destinationCells[cols[c]] == box)
+      {
+        cost = g_leavePushes;
+      }
+      penalized.at(r, c) = cost;
+    }
+  }
+  m_assignment.solve(std::move(penalized));
+  return std::max(assignment, toHeuristicValue(m_assignment.cost()));
+}
+
+// Greater of Hungarian taxicab and pattern database values. The database is built once per map
+// and shared by clones
+class PatternHeuristic : public Heuristic {
+public:
+  explicit PatternHeuristic(std::string cacheDirectory)
+    : m_hungarian(std::make_unique<HungarianHeuristic>(HeuristicType::HungarianTaxicab))
+    , m_cacheDirectory(std::move(cacheDirectory))
+  {}
+  virtual void init(const Map &m) noexcept override
+  {
+    Heuristic::init(m);
+    m_hungarian->init(m);
+    m_patterns = std::make_shared<const PatternDatabase>(m_map, PatternDatabase::g_maxGroupSize,
+                                                         m_cacheDirectory);
+  }
+  virtual std::string name() const noexcept override { return "Hungarian+PDB"; }
+  virtual std::unique_ptr<Heuristic> clone() const override
+  {
+    auto result = std::make_unique<PatternHeuristic>(m_cacheDirectory);
+    result->m_map = m_map;
+    result->m_inited = m_inited;
+    result->m_hungarian = m_hungarian->clone();
+    result->m_patterns = m_patterns;
+    return result;
+  }
+
+  virtual HeuristicValue operator()(const MapState &state) const noexcept override
+  {
+    return combine((*m_hungarian)(state), state);
+  }
+  virtual HeuristicValue evaluate(const MapState &state, size_t key) const noexcept override
+  {
+    return combine(m_hungarian->evaluate(state, key), state);
+  }
+  virtual HeuristicValue evaluate(const MapState &state, size_t key,
+                                  const BoxMove &move) const noexcept override
+  {
+    return combine(m_hungarian->evaluate(state, key, move), state);
+  }
+  // Bounds of the Hungarian part are bounds of the greater value too
+  virtual HeuristicValue lowerBound(const MapState &state) const noexcept override
+  {
+    return m_hungarian->lowerBound(state);
+  }
+  virtual HeuristicValue lowerBound(const MapState &state,
+                                    const BoxMove &move) const noexcept override
+  {
+    return m_hungarian->lowerBound(state, move);
+  }
+  virtual bool admissible() const noexcept override { return true; }
+  virtual size_t bytes() const noexcept override
+  {
+    return m_hungarian->bytes() + (m_patterns ? m_patterns->bytes() : 0);
+  }
+
+private:
+  HeuristicValue combine(HeuristicValue hungarian, const MapState &state) const
+  {
+    if (hungarian == g_unsolvable)
+    {
+      return hungarian;
+    }
+    return std::max(hungarian, m_patterns->evaluate(state.boxes));
+  }
+
+private:
+  std::unique_ptr<Heuristic> m_hungarian;
+  std::shared_ptr<const PatternDatabase> m_patterns;
+  std::string m_cacheDirectory;
+};
+
 } // namespace
 
-std::unique_ptr<Heuristic> Heuristic::create(HeuristicType type)
+std::unique_ptr<Heuristic> Heuristic::create(HeuristicType type, const std::string &cacheDirectory)
 {
   switch (type)
   {
   case HeuristicType::HungarianTaxicab:
-    return std::make_unique<HungarianHeuristic>(false);
   case HeuristicType::HungarianTaxicabPush:
-    return std::make_unique<HungarianHeuristic>(true);
+  case HeuristicType::HungarianPull:
+  case HeuristicType::HungarianPenalties:
+    return std::make_unique<HungarianHeuristic>(type);
+  case HeuristicType::HungarianPatternDatabase:
+    return std::make_unique<PatternHeuristic>(cacheDirectory);
   default:
     assert(false);
     return nullptr;
@@ -1,35 +1,90 @@
 #pragma once
 
 #include <cstddef>
+#include <cstdint>
+#include <limits>
 #include <vector>
 #include <memory>
+#include <string>
 
 #include "soko/map.h"
 
 namespace soko
 {
 
+// Pushes, left to solve a state, as estimated by a heuristic
+using HeuristicValue = uint32_t;
+// Heuristic value of a state, that can't be solved
+constexpr HeuristicValue g_unsolvable = std::numeric_limits<HeuristicValue>::max();
+
 struct MapState
 {
   std::vector<Pos> boxes;
   Pos unit;
 };
 
+// Single box movement between two states; parentKey identifies the state before the movement
+struct BoxMove
+{
+  size_t parentKey;
+  Pos from;
+  Pos to;
+};
+
 enum class HeuristicType
 {
   HungarianTaxicab,
+  // push distances with the unit, which has to walk round the box to push it from another side
   HungarianTaxicabPush,
+  // distances of pulling boxes: heuristic of the backward search, which destinations are
+  // initial box positions
+  HungarianPull,
+  // HungarianTaxicab or the additive pattern database of destination pairs, whichever is
+  // greater. See PatternDatabase
+  HungarianPatternDatabase,
+  // HungarianTaxicab with penalties of frozen boxes and of boxes on destinations, which block
+  // a box in a corridor
+  HungarianPenalties,
 };
 
 class Heuristic {
 public:
-  static std::unique_ptr<Heuristic> create(HeuristicType type);
+  // Pattern database tables are cached in `cacheDirectory`, if it isn't empty
+  static std::unique_ptr<Heuristic> create(HeuristicType type,
+                                           const std::string &cacheDirectory = {});
   Heuristic() = default;
   virtual void init(const Map &m) noexcept;
 
-  // TODO: save some space: heuristic should have uint32_t result
-  virtual size_t operator()(const MapState &boxes) const noexcept = 0;
+  // Returns g_unsolvable for states, that can't be solved
+  virtual HeuristicValue operator()(const MapState &boxes) const noexcept = 0;
+  // Same value as operator(). Solver passes a key, identifying the state, so that
+  // heuristic can keep data for the state and evaluate its successors faster
+  virtual HeuristicValue evaluate(const MapState &state, size_t /*key*/) const noexcept
+  {
+    return (*this)(state);
+  }
+  // Successor of the state with move.parentKey
+  virtual HeuristicValue evaluate(const MapState &state, size_t key,
+                                  const BoxMove & /*move*/) const noexcept
+  {
+    return evaluate(state, key);
+  }
+  // Cheap bound, not greater than the heuristic itself
+  virtual HeuristicValue lowerBound(const MapState &) const noexcept { return 0; }
+  // Cheap bound of the successor of the state with move.parentKey, not greater than
+  // evaluate(state, key, move)
+  virtual HeuristicValue lowerBound(const MapState &state,
+                                    const BoxMove & /*move*/) const noexcept
+  {
+    return lowerBound(state);
+  }
+  // Heuristic never exceeds the pushes, left to solve the state
+  virtual bool admissible() const noexcept { return false; }
+  // Bytes of the tables, built by init
+  virtual size_t bytes() const noexcept { return 0; }
   virtual std::string name() const noexcept = 0;
+  // Heuristic with the same map data and its own caches, e.g. for another search thread
+  virtual std::unique_ptr<Heuristic> clone() const = 0;
   bool inited() const noexcept { return m_inited; }
   void deinit() noexcept
   {
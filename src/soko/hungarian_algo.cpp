@@ -171,6 +171,163 @@ void HungarianAlgo::removeFromAdjacent(size_t i, size_t j)
   m_adjacent[col].erase(std::find(m_adjacent[col].begin(), m_adjacent[col].end(), i));
 }
 
+namespace
+{
+
+// Replaces g_inf: greater than any sum of allowed costs, small enough to sum without overflow
+constexpr IncrementalAssignment::Cost g_forbidden = IncrementalAssignment::Cost(1) << 40;
+
+} // namespace
+
+void IncrementalAssignment::solve(Mat<size_t> costs)
+{
+  assert(costs.rows() == costs.cols());
+  m_costs = std::move(costs);
+  const size_t n = m_costs.rows();
+  m_duals.rows.assign(n + 1, 0);
+  m_duals.cols.assign(n + 1, 0);
+  m_duals.colToRow.assign(n + 1, 0);
+  for (size_t i = 1; i <= n; ++i)
+  {
+    augment(i);
+  }
+}
+
+void IncrementalAssignment::repair(Mat<size_t> costs, const Duals &duals, size_t changedRow)
+{
+  assert(costs.rows() == costs.cols() && duals.colToRow.size() == costs.rows() + 1);
+  m_costs = std::move(costs);
+  m_duals = duals;
+  const size_t n = m_costs.rows();
+  const size_t row = changedRow + 1;
+  Cost minReduced = std::numeric_limits<Cost>::max();
+  for (size_t j = 1; j <= n; ++j)
+  {
+    if (m_duals.colToRow[j] == row)
+    {
+      m_duals.colToRow[j] = 0;
+    }
+    minReduced = std::min(minReduced, at(row, j) - m_duals.cols[j]);
+  }
+  // reduced costs of the row are non-negative again, other rows are not affected
+  m_duals.rows[row] = minReduced;
+  augment(row);
+}
+
+size_t IncrementalAssignment::repairBound(const Duals &duals, size_t changedRow,
+                                          const std::vector<size_t> &rowCosts) noexcept
+{
+  const size_t n = rowCosts.size();
+  assert(duals.colToRow.size() == n + 1);
+  const size_t row = changedRow + 1;
+  Cost result = 0;
+  Cost minReduced = std::numeric_limits<Cost>::max();
+  for (size_t j = 1; j <= n; ++j)
+  {
+    const Cost cost = rowCosts[j - 1] == g_inf ? g_forbidden : static_cast<Cost>(rowCosts[j - 1]);
+    minReduced = std::min(minReduced, cost - duals.cols[j]);
+    result += duals.cols[j] + (j == row ? 0 : duals.rows[j]);
+  }
+  result += minReduced;
+  if (result >= g_forbidden)
+  {
+    // some row has only forbidden pairs
+    return g_inf;
+  }
+  return result < 0 ? 0 : static_cast<size_t>(result);
+}
+
+size_t IncrementalAssignment::cost() const noexcept
+{
+  size_t result = 0;
+  for (size_t j = 1; j < m_duals.colToRow.size(); ++j)
+  {
+    size_t cost = m_costs.at(m_duals.colToRow[j] - 1, j - 1);
+    if (cost == g_inf)
+    {
+      return g_inf;
+    }
+    result += cost;
+  }
+  return result;
+}
+
+std::vector<size_t> IncrementalAssignment::assignment() const
+{
+  std::vector<size_t> result(m_duals.colToRow.size() - 1);
+  for (size_t j = 1; j < m_duals.colToRow.size(); ++j)
+  {
+    result[m_duals.colToRow[j] - 1] = j - 1;
+  }
+  return result;
+}
+
+IncrementalAssignment::Cost IncrementalAssignment::at(size_t row, size_t col) const noexcept
+{
+  size_t cost = m_costs.at(row - 1, col - 1);
+  return cost == g_inf ? g_forbidden : static_cast<Cost>(cost);
+}
+
+// Shortest augmenting path from the free row, Dijkstra over reduced costs
+void IncrementalAssignment::augment(size_t row)
+{
+  const size_t n = m_duals.colToRow.size() - 1;
+  auto &u = m_duals.rows;
+  auto &v = m_duals.cols;
+  auto &p = m_duals.colToRow;
+  m_minSlack.assign(n + 1, std::numeric_limits<Cost>::max());
+  m_way.assign(n + 1, 0);
+  m_used.assign(n + 1, false);
+
+  p[0] = row;
+  size_t col = 0;
+  do
+  {
+    m_used[col] = true;
+    const size_t i = p[col];
+    Cost delta = std::numeric_limits<Cost>::max();
+    size_t next = 0;
+    for (size_t j = 1; j <= n; ++j)
+    {
+      if (m_used[j])
+      {
+        continue;
+      }
+      Cost reduced = at(i, j) - u[i] - v[j];
+      if (reduced < m_minSlack[j])
+      {
+        m_minSlack[j] = reduced;
+        m_way[j] = col;
+      }
+      if (m_minSlack[j] < delta)
+      {
+        delta = m_minSlack[j];
+        next = j;
+      }
+    }
+    for (size_t j = 0; j <= n; ++j)
+    {
+      if (m_used[j])
+      {
+        u[p[j]] += delta;
+        v[j] -= delta;
+      }
+      else
+      {
+        m_minSlack[j] -= delta;
+      }
+    }
+    col = next;
+  } while (p[col] != 0);
+
+  do
+  {
+    size_t prev = m_way[col];
+    p[col] = p[prev];
+    col = prev;
+  } while (col != 0);
+}
+
 size_t HopcroftKarp::solve(const AdjacencyList &m)
 {
   m_nil = m.size();
@@ -1,4 +1,6 @@
 #pragma once
+#include <cstdint>
+
 #include "soko/mat.hpp"
 
 namespace soko
@@ -51,4 +53,48 @@ private:
   std::vector<bool> m_colZeroes;
 };
 
+
+// Assignment problem solver, that keeps dual potentials. Costs of a single row may be changed
+// afterwards: optimal assignment is repaired with one augmenting path in O(n^2) instead of
+// solving the problem again in O(n^3). g_inf marks forbidden pairs.
+class IncrementalAssignment {
+public:
+  using Cost = int64_t;
+
+  // Everything needed to continue from a solved problem. Indexes are shifted by one: 0 is
+  // an auxiliary column
+  struct Duals
+  {
+    std::vector<Cost> rows;
+    std::vector<Cost> cols;
+    std::vector<size_t> colToRow;
+  };
+
+  void solve(Mat<size_t> costs);
+  // `costs` differ from the problem `duals` were calculated for only in `changedRow`
+  void repair(Mat<size_t> costs, const Duals &duals, size_t changedRow);
+  // Lower bound of the optimal cost after the costs of `changedRow` become `rowCosts`, in O(n):
+  // duals stay feasible, if the row's potential is lowered to its least reduced cost
+  static size_t repairBound(const Duals &duals, size_t changedRow,
+                            const std::vector<size_t> &rowCosts) noexcept;
+
+  // Sum of assigned costs or g_inf, if rows can't be assigned with allowed pairs
+  size_t cost() const noexcept;
+  // Column for each row
+  std::vector<size_t> assignment() const;
+  const Duals &duals() const noexcept { return m_duals; }
+
+private:
+  Cost at(size_t row, size_t col) const noexcept;
+  void augment(size_t row);
+
+private:
+  Mat<size_t> m_costs;
+  Duals m_duals;
+
+  std::vector<Cost> m_minSlack;
+  std::vector<size_t> m_way;
+  std::vector<bool> m_used;
+};
+
 } // namespace soko
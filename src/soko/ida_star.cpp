@@ -0,0 +1,120 @@
+#include "soko/ida_star.h"
+
+namespace soko
+{
+
+IdaStar::IdaStar(SearchSpace &space, const Heuristic &heuristic, const SolverConfig &config,
+                 SolverStatistics &statistics)
+  : m_space(space)
+  , m_heuristic(heuristic)
+  , m_config(config)
+  , m_statistics(statistics)
+  , m_table(config.tableBytes)
+{}
+
+bool IdaStar::solve(std::vector<BoxMovement> &result)
+{
+  ++m_statistics.heuristicCalls;
+  const HeuristicValue h = m_heuristic.evaluate(m_space.initialState(), m_lastKey);
+  if (h == g_unsolvable)
+  {
+    return false;
+  }
+
+  bool solved = false;
+  m_bound = h;
+  while (!solved && !m_stopped)
+  {
+    ++m_iteration;
+    ++m_statistics.iterations;
+    m_nextBound = g_inf;
+    solved = search(m_space.root(), m_space.rootHash(), 0, 0, h);
+    if (m_nextBound == g_inf)
+    {
+      break;
+    }
+    m_bound = m_nextBound;
+  }
+
+  m_statistics.closedSet = m_table.statistics();
+  m_statistics.nodes = m_table.size();
+  if (solved)
+  {
+    result = m_path;
+  }
+  return solved;
+}
+
+bool IdaStar::search(const CompactState &state, StateHash hash, size_t key, size_t g,
+                     HeuristicValue h)
+{
+  if (g + h > m_bound)
+  {
+    m_nextBound = std::min(m_nextBound, g + h);
+    return false;
+  }
+  if (h == 0)
+  {
+    return true;
+  }
+  Visit *visit = m_table.find(hash);
+  if (visit != nullptr && visit->iteration == m_iteration && visit->g <= g)
+  {
+    return false;
+  }
+  if (m_config.maxNodes != 0 && m_statistics.expanded >= m_config.maxNodes)
+  {
+    m_stopped = true;
+    return false;
+  }
+  m_table.store(hash, {static_cast<uint32_t>(g), m_iteration});
+  ++m_statistics.expanded;
+
+  if (m_levels.size() <= g)
+  {
+    m_levels.resize(g + 1);
+  }
+  Level &level = m_levels[g];
+  level.successors.clear();
+  level.children.clear();
+  m_space.expand(state, hash, level.successors);
+  m_statistics.generated += level.successors.size();
+
+  // the most promising successors first
+  for (size_t i = 0; i < level.successors.size(); ++i)
+  {
+    const Successor &successor = level.successors[i];
+    if (!m_space.isValid(successor, m_mapState))
+    {
+      continue;
+    }
+    ++m_statistics.heuristicCalls;
+    const size_t childKey = ++m_lastKey;
+    const HeuristicValue childH =
+        m_heuristic.evaluate(m_mapState, childKey, m_space.boxMove(key, successor));
+    if (childH != g_unsolvable)
+    {
+      level.children.push_back({childH, static_cast<uint32_t>(i), childKey});
+    }
+  }
+  std::stable_sort(level.children.begin(), level.children.end(),
+                   [](const Child &l, const Child &r) { return l.h < r.h; });
+
+  for (const Child &child : level.children)
+  {
+    const Successor &successor = level.successors[child.index];
+    m_path.push_back(m_space.boxMovement(successor));
+    if (search(successor.state, successor.hash, child.key, g + successor.cost, child.h))
+    {
+      return true;
+    }
+    m_path.pop_back();
+    if (m_stopped)
+    {
+      return false;
+    }
+  }
+  return false;
+}
+
+} // namespace soko
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <deque>
+
+#include "soko/search_space.h"
+#include "soko/solver.h"
+#include "soko/transposition_table.hpp"
+
+namespace soko
+{
+
+// Iterative deepening A*: depth-first searches, bounded by f, the bound grows to the least
+// exceeding f after every search. Memory doesn't depend on the amount of visited states: the
+// search keeps only the current path and a fixed-size transposition table, which cuts off
+// states, already visited with fewer pushes during the same iteration.
+class IdaStar {
+public:
+  IdaStar(SearchSpace &space, const Heuristic &heuristic, const SolverConfig &config,
+          SolverStatistics &statistics);
+
+  // Returns false if there is no solution or the node limit is reached
+  bool solve(std::vector<BoxMovement> &result);
+
+private:
+  struct Visit
+  {
+    uint32_t g;
+    uint32_t iteration;
+  };
+
+  struct Child
+  {
+    HeuristicValue h;
+    uint32_t index;
+    size_t key;
+  };
+
+  // successors of the path state at some depth
+  struct Level
+  {
+    std::vector<Successor> successors;
+    std::vector<Child> children;
+  };
+
+  bool search(const CompactState &state, StateHash hash, size_t key, size_t g, HeuristicValue h);
+
+private:
+  SearchSpace &m_space;
+  const Heuristic &m_heuristic;
+  const SolverConfig &m_config;
+  SolverStatistics &m_statistics;
+  BoundedTranspositionTable<Visit> m_table;
+
+  size_t m_bound = 0;
+  size_t m_nextBound = 0;
+  uint32_t m_iteration = 0;
+  bool m_stopped = false;
+  // heuristic cache keys, unique for each evaluated state
+  size_t m_lastKey = 0;
+
+  // deque: references to levels stay valid while deeper levels are added
+  std::deque<Level> m_levels;
+  std::vector<BoxMovement> m_path;
+  MapState m_mapState;
+};
+
+} // namespace soko
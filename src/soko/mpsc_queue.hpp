@@ -0,0 +1,36 @@
+#pragma once
+
+#include <atomic>
+
+namespace soko
+{
+
+// Lock-free queue of intrusive items (T has a `T *next` member): any thread pushes, the single
+// owner takes all pushed items at once. Since items are never taken one by one, the usual
+// ABA problem of lock-free stacks doesn't occur. Items are returned in LIFO order.
+template<typename T>
+class MpscQueue {
+public:
+  MpscQueue() = default;
+  MpscQueue(const MpscQueue &) = delete;
+  MpscQueue &operator=(const MpscQueue &) = delete;
+
+  void push(T *item) noexcept
+  {
+    item->next = m_head.load(std::memory_order_relaxed);
+    while (!m_head.compare_exchange_weak(item->next, item, std::memory_order_release,
+                                         std::memory_order_relaxed))
+    {
+    }
+  }
+
+  // Consumer only. Returns the list of all pushed items or nullptr
+  T *takeAll() noexcept { return m_head.exchange(nullptr, std::memory_order_acquire); }
+
+  bool empty() const noexcept { return m_head.load(std::memory_order_relaxed) == nullptr; }
+
+private:
+  std::atomic<T *> m_head{nullptr};
+};
+
+} // namespace soko
@@ -0,0 +1,65 @@
+#include "soko/node_arena.h"
+
+#include <new>
+
+namespace soko
+{
+
+void NodeArena::reset(size_t cells) noexcept
+{
+  const size_t align = alignof(NodeHeader);
+  size_t stride = sizeof(NodeHeader) + cells * sizeof(CellIndex);
+  stride = (stride + align - 1) / align * align;
+
+  size_t shift = 0;
+  while ((size_t(2) << shift) * stride <= m_slabBytes)
+  {
+    ++shift;
+  }
+  if (stride > m_slabBytes)
+  {
+    // a single record doesn't fit into existing slabs
+    release();
+    m_slabBytes = stride;
+  }
+
+  m_cells = cells;
+  m_stride = stride;
+  m_slabShift = shift;
+  m_slabMask = (size_t(1) << shift) - 1;
+  m_size = 0;
+}
+
+void NodeArena::release() noexcept
+{
+  m_slabs.clear();
+  m_slabs.shrink_to_fit();
+  m_size = 0;
+}
+
+NodeId NodeArena::allocate(NodeId parent, StateHash hash, const CellIndex *cells, uint32_t g)
+{
+  assert(m_stride != 0);
+  if (m_size == g_noNode)
+  {
+    throw std::length_error("Too many search nodes");
+  }
+  if ((m_size >> m_slabShift) == m_slabs.size())
+  {
+    // not value-initialized
+    m_slabs.emplace_back(new std::byte[m_slabBytes]);
+  }
+  NodeId id = static_cast<NodeId>(m_size++);
+  std::byte *p = record(id);
+  new (p) NodeHeader{hash, parent, g};
+  std::memcpy(p + sizeof(NodeHeader), cells, m_cells * sizeof(CellIndex));
+  return id;
+}
+
+bool NodeArena::equal(NodeId id, const CompactState &state) const noexcept
+{
+  assert(state.cellCount() == m_cells);
+  return std::memcmp(cells(id), state.cells(), m_cells * sizeof(CellIndex)) == 0;
+}
+
+} // namespace soko
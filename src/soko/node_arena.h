@@ -0,0 +1,82 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "soko/compact_state.h"
+#include "soko/zobrist.h"
+
+namespace soko
+{
+
+using NodeId = uint32_t;
+constexpr NodeId g_noNode = std::numeric_limits<NodeId>::max();
+
+struct NodeHeader
+{
+  StateHash hash;
+  NodeId parent;
+  // pushes from the root along the best known path
+  uint32_t g;
+};
+
+// Monotonic storage of search nodes. Each node is a fixed-size record: header followed by state
+// cells (boxes and unit). Records are placed into equal slabs and addressed by 32-bit ids.
+// Nodes are never freed one by one: reset() drops all of them at once and keeps the slabs
+// for reuse.
+class NodeArena {
+public:
+  explicit NodeArena(size_t slabBytes = 1 << 20) noexcept
+    : m_slabBytes(slabBytes)
+  {}
+  NodeArena(const NodeArena &) = delete;
+  NodeArena &operator=(const NodeArena &) = delete;
+
+  // Drops all nodes; following nodes will have `cells` state cells. O(1)
+  void reset(size_t cells = 0) noexcept;
+  // Frees slabs
+  void release() noexcept;
+
+  NodeId allocate(NodeId parent, StateHash hash, const CellIndex *cells, uint32_t g = 0);
+
+  NodeHeader &header(NodeId id) noexcept { return *reinterpret_cast<NodeHeader *>(record(id)); }
+  const NodeHeader &header(NodeId id) const noexcept
+  {
+    return *reinterpret_cast<const NodeHeader *>(record(id));
+  }
+  const CellIndex *cells(NodeId id) const noexcept
+  {
+    return reinterpret_cast<const CellIndex *>(record(id) + sizeof(NodeHeader));
+  }
+  bool equal(NodeId id, const CompactState &state) const noexcept;
+  CompactState state(NodeId id) const { return CompactState(cells(id), m_cells); }
+
+  size_t size() const noexcept { return m_size; }
+  size_t cellCount() const noexcept { return m_cells; }
+  size_t recordBytes() const noexcept { return m_stride; }
+  // Bytes occupied by nodes
+  size_t bytesUsed() const noexcept { return m_size * m_stride; }
+  // Bytes allocated for slabs
+  size_t bytesReserved() const noexcept { return m_slabs.size() * m_slabBytes; }
+
+private:
+  std::byte *record(NodeId id) const noexcept
+  {
+    assert(id < m_size);
+    return m_slabs[id >> m_slabShift].get() + (id & m_slabMask) * m_stride;
+  }
+
+private:
+  size_t m_slabBytes;
+  std::vector<std::unique_ptr<std::byte[]>> m_slabs;
+
+  size_t m_cells = 0;
+  size_t m_stride = 0;
+  // nodes per slab is a power of two
+  size_t m_slabShift = 0;
+  size_t m_slabMask = 0;
+  size_t m_size = 0;
+};
+
+} // namespace soko
@@ -0,0 +1,53 @@
+#include "soko/open_list.h"
+
+namespace soko
+{
+
+void BucketQueue::push(NodeId node, uint32_t g, HeuristicValue h)
+{
+  const size_t f = size_t(g) + h;
+  if (f >= m_buckets.size())
+  {
+    m_buckets.resize(f + 1);
+  }
+  FBucket &bucket = m_buckets[f];
+  if (h >= bucket.byH.size())
+  {
+    bucket.byH.resize(h + 1);
+  }
+  bucket.byH[h].push_back(node);
+
+  if (bucket.size == 0 || h < bucket.minH)
+  {
+    bucket.minH = h;
+  }
+  ++bucket.size;
+  if (m_size == 0 || f < m_minF)
+  {
+    m_minF = f;
+  }
+  ++m_size;
+}
+
+OpenEntry BucketQueue::pop()
+{
+  assert(!empty());
+  while (m_buckets[m_minF].size == 0)
+  {
+    ++m_minF;
+  }
+  FBucket &bucket = m_buckets[m_minF];
+  while (bucket.byH[bucket.minH].empty())
+  {
+    ++bucket.minH;
+  }
+  auto &entries = bucket.byH[bucket.minH];
+  OpenEntry result = {entries.back(), static_cast<uint32_t>(m_minF - bucket.minH),
+                      static_cast<HeuristicValue>(bucket.minH)};
+  entries.pop_back();
+  --bucket.size;
+  --m_size;
+  return result;
+}
+
+} // namespace soko
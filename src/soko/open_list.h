@@ -0,0 +1,72 @@
+#pragma once
+
+#include <queue>
+#include <vector>
+
+#include "soko/heuristic.h"
+#include "soko/node_arena.h"
+
+namespace soko
+{
+
+// Entry of 12 bytes: open lists of hard levels keep tens of millions of them
+struct OpenEntry
+{
+  NodeId node;
+  uint32_t g;
+  HeuristicValue h;
+
+  size_t f() const noexcept { return size_t(g) + h; }
+};
+static_assert(sizeof(OpenEntry) == 12, "OpenEntry isn't packed");
+
+// Open list as a binary heap, ordered by f; ties are broken toward lower h
+class BinaryHeapQueue {
+public:
+  void push(NodeId node, uint32_t g, HeuristicValue h) { m_heap.push({node, g, h}); }
+  OpenEntry pop()
+  {
+    OpenEntry result = m_heap.top();
+    m_heap.pop();
+    return result;
+  }
+  bool empty() const noexcept { return m_heap.empty(); }
+  size_t size() const noexcept { return m_heap.size(); }
+
+private:
+  struct Greater
+  {
+    bool operator()(const OpenEntry &left, const OpenEntry &right) const noexcept
+    {
+      return left.f() > right.f() || (left.f() == right.f() && left.h > right.h);
+    }
+  };
+
+  std::priority_queue<OpenEntry, std::vector<OpenEntry>, Greater> m_heap;
+};
+
+// Open list for small integer priorities: array of f-buckets, each one split into h-buckets.
+// Entry with minimal f is extracted first, ties are broken toward lower h.
+// Within a bucket entries are extracted in LIFO order.
+// Push is O(1), extraction is amortised O(1): f rarely decreases during the search.
+class BucketQueue {
+public:
+  void push(NodeId node, uint32_t g, HeuristicValue h);
+  OpenEntry pop();
+  bool empty() const noexcept { return m_size == 0; }
+  size_t size() const noexcept { return m_size; }
+
+private:
+  struct FBucket
+  {
+    std::vector<std::vector<NodeId>> byH;
+    size_t minH = 0;
+    size_t size = 0;
+  };
+
+  std::vector<FBucket> m_buckets;
+  size_t m_minF = 0;
+  size_t m_size = 0;
+};
+
+} // namespace soko
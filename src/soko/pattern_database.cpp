@@ -0,0 +1,502 @@
+#include "soko/pattern_database.h"
+#include "soko/reachability.h"
+
+#include <algorithm>
+#include <array>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+
+namespace soko
+{
+
+namespace
+{
+
+namespace fs = std::filesystem;
+
+constexpr std::array<Move, 4> g_moves = {Move::Left, Move::Right, Move::Up, Move::Down};
+
+// Pushes of the table: the placement can't be moved onto the destinations
+constexpr uint16_t g_noPushes = std::numeric_limits<uint16_t>::max();
+
+constexpr char g_magic[8] = {'S', 'O', 'K', 'O', 'P', 'D', 'B', '1'};
+
+// Placement of a group's boxes and the normalized unit position
+struct Placement
+{
+  // increasing
+  std::array<CellIndex, PatternDatabase::g_maxGroupSize> boxes;
+  CellIndex unit;
+};
+
+// FNV-1a
+uint64_t hash(const std::vector<uint8_t> &data) noexcept
+{
+  uint64_t result = 14695981039346656037ull;
+  for (uint8_t byte : data)
+  {
+    result = (result ^ byte) * 1099511628211ull;
+  }
+  return result;
+}
+
+template<typename T>
+void writeValue(std::ofstream &file, const T &value)
+{
+  file.write(reinterpret_cast<const char *>(&value), sizeof(T));
+}
+
+template<typename T>
+void writeValues(std::ofstream &file, const std::vector<T> &values)
+{
+  writeValue(file, static_cast<uint64_t>(values.size()));
+  file.write(reinterpret_cast<const char *>(values.data()),
+             static_cast<std::streamsize>(values.size() * sizeof(T)));
+}
+
+template<typename T>
+bool readValue(std::ifstream &file, T &value)
+{
+  return static_cast<bool>(file.read(reinterpret_cast<char *>(&value), sizeof(T)));
+}
+
+template<typename T>
+bool readValues(std::ifstream &file, std::vector<T> &values, size_t expectedSize)
+{
+  uint64_t size = 0;
+  if (!readValue(file, size) || size != expectedSize)
+  {
+    return false;
+  }
+  values.resize(expectedSize);
+  return static_cast<bool>(file.read(reinterpret_cast<char *>(values.data()),
+                                     static_cast<std::streamsize>(size * sizeof(T))));
+}
+
+} // namespace
+
+PatternDatabase::PatternDatabase(const MapStatic &map, size_t groupSize,
+                                 const std::string &cacheDirectory)
+{
+  assert(groupSize >= 1 && groupSize <= g_maxGroupSize);
+  m_cols = map.cols();
+  m_numbers.assign(map.rows() * map.cols(), g_noCell);
+  for (size_t cell = 0; cell < m_numbers.size(); ++cell)
+  {
+    if (map.isFree(toPos(static_cast<CellIndex>(cell), map.cols())))
+    {
+      m_numbers[cell] = static_cast<CellIndex>(m_boxCells++);
+    }
+  }
+  m_binomial.assign((m_boxCells + 1) * (g_maxGroupSize + 1), 0);
+  for (size_t n = 0; n <= m_boxCells; ++n)
+  {
+    m_binomial[n * (g_maxGroupSize + 1)] = 1;
+    for (size_t k = 1; k <= std::min(n, g_maxGroupSize); ++k)
+    {
+      m_binomial[n * (g_maxGroupSize + 1) + k] = binomial(n - 1, k - 1) + binomial(n - 1, k);
+    }
+  }
+  makeGroups(map, groupSize);
+  makeBounds(map);
+
+  std::string path;
+  const std::vector<uint8_t> key = layout(map, groupSize);
+  if (!cacheDirectory.empty())
+  {
+    char name[32];
+    std::snprintf(name, sizeof(name), "pdb-%016llx.bin",
+                  static_cast<unsigned long long>(hash(key)));
+    path = (fs::path(cacheDirectory) / name).string();
+    m_loadedFromCache = load(path, key);
+    if (m_loadedFromCache)
+    {
+      return;
+    }
+  }
+  for (Group &group : m_groups)
+  {
+    build(map, group);
+  }
+  if (!path.empty())
+  {
+    save(path, key);
+  }
+}
+
+void PatternDatabase::makeGroups(const MapStatic &map, size_t groupSize)
+{
+  std::vector<Pos> destinations;
+  for (size_t i = 0; i < map.rows(); ++i)
+  {
+    for (size_t j = 0; j < map.cols(); ++j)
+    {
+      if (map.at(i, j) == Cell::Destination)
+      {
+        destinations.push_back({i, j});
+      }
+    }
+  }
+
+  // each group starts from the first free destination and takes the nearest free ones
+  auto distance = [](Pos l, Pos r) {
+    return (l.i > r.i ? l.i - r.i : r.i - l.i) + (l.j > r.j ? l.j - r.j : r.j - l.j);
+  };
+  std::vector<bool> grouped(destinations.size());
+  for (size_t first = 0; first < destinations.size(); ++first)
+  {
+    if (grouped[first])
+    {
+      continue;
+    }
+    Group group;
+    grouped[first] = true;
+    group.destinations.push_back(toCellIndex(destinations[first], map.cols()));
+    while (group.destinations.size() < groupSize)
+    {
+      size_t nearest = destinations.size();
+      for (size_t j = first + 1; j < destinations.size(); ++j)
+      {
+        if (!grouped[j] && (nearest == destinations.size() ||
+                            distance(destinations[first], destinations[j]) <
+                                distance(destinations[first], destinations[nearest])))
+        {
+          nearest = j;
+        }
+      }
+      if (nearest == destinations.size())
+      {
+        break;
+      }
+      grouped[nearest] = true;
+      group.destinations.push_back(toCellIndex(destinations[nearest], map.cols()));
+    }
+    std::sort(group.destinations.begin(), group.destinations.end());
+    m_groups.push_back(std::move(group));
+  }
+}
+
+size_t PatternDatabase::index(const CellIndex *cells, size_t count) const noexcept
+{
+  size_t result = 0;
+  for (size_t i = 0; i < count; ++i)
+  {
+    assert(m_numbers[cells[i]] != g_noCell);
+    result += binomial(m_numbers[cells[i]], i + 1);
+  }
+  return result;
+}
+
+void PatternDatabase::makeBounds(const MapStatic &map)
+{
+  Reachability reachability(map);
+  m_bounds.assign(m_boxCells * m_groups.size(), g_noPushes);
+  std::vector<uint16_t> pushes(m_numbers.size());
+  std::vector<CellIndex> layer;
+  for (size_t g = 0; g < m_groups.size(); ++g)
+  {
+    // pull search of a single box from all the group's destinations
+    std::fill(pushes.begin(), pushes.end(), g_noPushes);
+    layer = m_groups[g].destinations;
+    for (CellIndex destination : layer)
+    {
+      pushes[destination] = 0;
+    }
+    for (size_t i = 0; i < layer.size(); ++i)
+    {
+      const CellIndex box = layer[i];
+      m_bounds[m_numbers[box] * m_groups.size() + g] = pushes[box];
+      for (Move m : g_moves)
+      {
+        CellIndex to = reachability.neighbour(box, m);
+        if (to != g_noCell && reachability.neighbour(to, m) != g_noCell &&
+            pushes[to] == g_noPushes)
+        {
+          pushes[to] = static_cast<uint16_t>(pushes[box] + 1);
+          layer.push_back(to);
+        }
+      }
+    }
+  }
+}
+
+void PatternDatabase::build(const MapStatic &map, Group &group) const
+{
+  const size_t boxes = group.destinations.size();
+  const size_t cells = m_numbers.size();
+  group.pushes.assign(binomial(m_boxCells, boxes), g_noPushes);
+  // placements with the unit area, met by the pull search
+  std::vector<bool> visited(group.pushes.size() * cells);
+  auto visit = [&](const Placement &p) {
+    const size_t key = index(p.boxes.data(), boxes) * cells + p.unit;
+    if (visited[key])
+    {
+      return false;
+    }
+    visited[key] = true;
+    return true;
+  };
+
+  Reachability reachability(map);
+  std::vector<Placement> layer;
+  Placement goal;
+  std::copy(group.destinations.begin(), group.destinations.end(), goal.boxes.begin());
+  reachability.setBoxes(goal.boxes.data(), boxes);
+  for (size_t cell = 0; cell < cells; ++cell)
+  {
+    // every unit area around the placed boxes
+    if (m_numbers[cell] != g_noCell && !reachability.isBox(static_cast<CellIndex>(cell)))
+    {
+      goal.unit = reachability.fill(static_cast<CellIndex>(cell));
+      if (visit(goal))
+      {
+        layer.push_back(goal);
+      }
+    }
+  }
+
+  struct Pull
+  {
+    size_t box;
+    CellIndex to;
+    CellIndex unit;
+  };
+  std::vector<Pull> pulls;
+  std::vector<Placement> next;
+  for (uint16_t pushes = 0; !layer.empty() && pushes != g_noPushes; ++pushes)
+  {
+    next.clear();
+    for (const Placement &placement : layer)
+    {
+      uint16_t &least = group.pushes[index(placement.boxes.data(), boxes)];
+      least = std::min(least, pushes);
+
+      // box is pulled by the unit, standing next to it, which steps back
+      reachability.setBoxes(placement.boxes.data(), boxes);
+      reachability.fill(placement.unit);
+      pulls.clear();
+      for (size_t i = 0; i < boxes; ++i)
+      {
+        for (Move m : g_moves)
+        {
+          CellIndex to = reachability.neighbour(placement.boxes[i], m);
+          if (to == g_noCell || !reachability.isReachable(to))
+          {
+            continue;
+          }
+          CellIndex unit = reachability.neighbour(to, m);
+          if (reachability.isFree(unit))
+          {
+            pulls.push_back({i, to, unit});
+          }
+        }
+      }
+
+      for (const Pull &pull : pulls)
+      {
+        Placement child = placement;
+        child.boxes[pull.box] = pull.to;
+        // the moved box goes to its place among the others
+        for (size_t j = pull.box; j + 1 < boxes && child.boxes[j] > child.boxes[j + 1]; ++j)
+        {
+          std::swap(child.boxes[j], child.boxes[j + 1]);
+        }
+        for (size_t j = pull.box; j > 0 && child.boxes[j - 1] > child.boxes[j]; --j)
+        {
+          std::swap(child.boxes[j - 1], child.boxes[j]);
+        }
+        reachability.moveBox(placement.boxes[pull.box], pull.to);
+        child.unit = reachability.fill(pull.unit);
+        reachability.moveBox(pull.to, placement.boxes[pull.box]);
+        if (visit(child))
+        {
+          next.push_back(child);
+        }
+      }
+    }
+    layer.swap(next);
+  }
+}
+
+uint16_t PatternDatabase::leastPushes(const Group &group,
+                                      const std::vector<Candidate> &candidates) const noexcept
+{
+  static_assert(g_maxGroupSize == 2, "only single boxes and pairs are looked up");
+  // pushes of a placement are at least the sum of its bounds, so the scan stops, when no
+  // further placement can be cheaper
+  uint16_t result = g_noPushes;
+  const size_t count = candidates.size();
+  if (group.destinations.size() == 1)
+  {
+    for (size_t i = 0; i < count && candidates[i].bound < result; ++i)
+    {
+      result = std::min(result, group.pushes[candidates[i].number]);
+    }
+    return result;
+  }
+  for (size_t i = 0; i + 1 < count && candidates[i].bound + candidates[i + 1].bound < result; ++i)
+  {
+    for (size_t j = i + 1; j < count && candidates[i].bound + candidates[j].bound < result; ++j)
+    {
+      result = std::min(result, group.pushes[pairIndex(candidates[i].number, candidates[j].number)]);
+    }
+  }
+  return result;
+}
+
+HeuristicValue PatternDatabase::evaluate(const std::vector<Pos> &boxes) const
+{
+  // two boxes with the least bounds of each group: usually they are the cheapest placement
+  const size_t groups = m_groups.size();
+  std::vector<Candidate> least(groups * 2, Candidate{g_noPushes, g_noCell});
+  std::vector<CellIndex> numbers(boxes.size());
+  for (size_t i = 0; i < boxes.size(); ++i)
+  {
+    const CellIndex number = m_numbers[toCellIndex(boxes[i], m_cols)];
+    numbers[i] = number;
+    const uint16_t *bounds = m_bounds.data() + number * groups;
+    for (size_t g = 0; g < groups; ++g)
+    {
+      Candidate *pair = &least[g * 2];
+      if (bounds[g] < pair[1].bound)
+      {
+        pair[1] = {bounds[g], number};
+        if (pair[1].bound < pair[0].bound)
+        {
+          std::swap(pair[0], pair[1]);
+        }
+      }
+    }
+  }
+
+  HeuristicValue result = 0;
+  std::vector<Candidate> candidates;
+  for (size_t g = 0; g < groups; ++g)
+  {
+    const Group &group = m_groups[g];
+    const Candidate *pair = &least[g * 2];
+    uint16_t pushes = g_noPushes;
+    if (group.destinations.size() == 1)
+    {
+      if (pair[0].bound != g_noPushes && group.pushes[pair[0].number] == pair[0].bound)
+      {
+        pushes = pair[0].bound;
+      }
+    }
+    else if (pair[1].bound != g_noPushes &&
+             group.pushes[pairIndex(pair[0].number, pair[1].number)] ==
+                 pair[0].bound + pair[1].bound)
+    {
+      pushes = static_cast<uint16_t>(pair[0].bound + pair[1].bound);
+    }
+
+    if (pushes == g_noPushes)
+    {
+      // boxes hinder each other or the unit: other placements are looked up
+      candidates.clear();
+      for (CellIndex number : numbers)
+      {
+        candidates.push_back({m_bounds[number * groups + g], number});
+      }
+      std::sort(candidates.begin(), candidates.end(),
+                [](const Candidate &l, const Candidate &r) { return l.bound < r.bound; });
+      pushes = leastPushes(group, candidates);
+      if (pushes == g_noPushes)
+      {
+        return g_unsolvable;
+      }
+    }
+    result += pushes;
+  }
+  return result;
+}
+
+size_t PatternDatabase::bytes() const noexcept
+{
+  size_t result = m_numbers.size() * sizeof(CellIndex) + m_binomial.size() * sizeof(size_t) +
+                  m_bounds.size() * sizeof(uint16_t);
+  for (const Group &group : m_groups)
+  {
+    result += group.destinations.size() * sizeof(CellIndex) +
+              group.pushes.size() * sizeof(uint16_t);
+  }
+  return result;
+}
+
+std::vector<uint8_t> PatternDatabase::layout(const MapStatic &map, size_t groupSize) const
+{
+  std::vector<uint8_t> result;
+  for (size_t value : {groupSize, map.rows(), map.cols()})
+  {
+    for (size_t byte = 0; byte < 4; ++byte)
+    {
+      result.push_back(static_cast<uint8_t>(value >> (byte * 8)));
+    }
+  }
+  for (size_t i = 0; i < map.rows(); ++i)
+  {
+    for (size_t j = 0; j < map.cols(); ++j)
+    {
+      result.push_back(static_cast<uint8_t>(map.at(i, j)));
+    }
+  }
+  return result;
+}
+
+bool PatternDatabase::load(const std::string &path, const std::vector<uint8_t> &layout)
+{
+  std::ifstream file(path, std::ios::binary);
+  char magic[sizeof(g_magic)];
+  if (!file || !file.read(magic, sizeof(magic)) || !std::equal(magic, magic + sizeof(magic), g_magic))
+  {
+    return false;
+  }
+  // file names are hashes of layouts: layout itself tells collisions apart
+  std::vector<uint8_t> stored;
+  if (!readValues(file, stored, layout.size()) || stored != layout)
+  {
+    return false;
+  }
+  std::vector<CellIndex> destinations;
+  for (Group &group : m_groups)
+  {
+    if (!readValues(file, destinations, group.destinations.size()) ||
+        destinations != group.destinations ||
+        !readValues(file, group.pushes, binomial(m_boxCells, group.destinations.size())))
+    {
+      for (Group &g : m_groups)
+      {
+        g.pushes.clear();
+      }
+      return false;
+    }
+  }
+  return true;
+}
+
+void PatternDatabase::save(const std::string &path, const std::vector<uint8_t> &layout) const
+{
+  // written under a temporary name, so that a concurrent reader never sees a partial file
+  const std::string temporary = path + ".tmp";
+  {
+    std::ofstream file(temporary, std::ios::binary);
+    file.write(g_magic, sizeof(g_magic));
+    writeValues(file, layout);
+    for (const Group &group : m_groups)
+    {
+      writeValues(file, group.destinations);
+      writeValues(file, group.pushes);
+    }
+    if (!file)
+    {
+      std::error_code error;
+      fs::remove(temporary, error);
+      return;
+    }
+  }
+  std::error_code error;
+  fs::rename(temporary, path, error);
+}
+
+} // namespace soko
@@ -0,0 +1,87 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "soko/compact_state.h"
+#include "soko/heuristic.h"
+
+namespace soko
+{
+
+// Additive pattern database over groups of destinations. Destinations are split into groups of
+// nearby ones; the table of a group keeps, for every placement of the group's amount of boxes,
+// the least pushes to move them onto the group's destinations with the other boxes removed and
+// the unit anywhere. Tables are built by a breadth-first pull search from the goal placements,
+// so they take box-box and unit interactions inside a group into account.
+// Boxes are identical, so each group takes its cheapest boxes: a box may be counted by several
+// groups. The sum is still a lower bound of pushes: boxes of a solution, which fill a group,
+// are never cheaper than the group's cheapest ones.
+class PatternDatabase {
+public:
+  // bigger groups make too many placements of boxes on a usual level
+  static constexpr size_t g_maxGroupSize = 2;
+
+  PatternDatabase() = default;
+  // Tables are loaded from `cacheDirectory`, if they were saved there for the same layout.
+  // Otherwise they're built and saved; the cache is optional, so its I/O errors are ignored
+  PatternDatabase(const MapStatic &map, size_t groupSize, const std::string &cacheDirectory = {});
+
+  // Returns g_unsolvable if some group can't be filled by the boxes
+  HeuristicValue evaluate(const std::vector<Pos> &boxes) const;
+
+  size_t groups() const noexcept { return m_groups.size(); }
+  size_t bytes() const noexcept;
+  bool loadedFromCache() const noexcept { return m_loadedFromCache; }
+
+private:
+  struct Group
+  {
+    // map cells, increasing
+    std::vector<CellIndex> destinations;
+    // pushes by the combination index of the box cell numbers
+    std::vector<uint16_t> pushes;
+  };
+
+  // Box of the evaluated state with its bound in a group
+  struct Candidate
+  {
+    uint16_t bound;
+    CellIndex number;
+  };
+
+  void makeGroups(const MapStatic &map, size_t groupSize);
+  void build(const MapStatic &map, Group &group) const;
+  void makeBounds(const MapStatic &map);
+  // Combination index of increasing map cells
+  size_t index(const CellIndex *cells, size_t count) const noexcept;
+  size_t binomial(size_t n, size_t k) const noexcept
+  {
+    return m_binomial[n * (g_maxGroupSize + 1) + k];
+  }
+  size_t pairIndex(CellIndex l, CellIndex r) const noexcept
+  {
+    return l < r ? l + binomial(r, 2) : r + binomial(l, 2);
+  }
+  // Least pushes of the group with the candidates, ordered by bounds
+  uint16_t leastPushes(const Group &group, const std::vector<Candidate> &candidates) const noexcept;
+
+  // Level layout and group size: the key of the cache file
+  std::vector<uint8_t> layout(const MapStatic &map, size_t groupSize) const;
+  bool load(const std::string &path, const std::vector<uint8_t> &layout);
+  void save(const std::string &path, const std::vector<uint8_t> &layout) const;
+
+private:
+  // number of each cell among the cells, where a box can stand; g_noCell for walls
+  std::vector<CellIndex> m_numbers;
+  size_t m_cols = 0;
+  size_t m_boxCells = 0;
+  std::vector<size_t> m_binomial;
+  std::vector<Group> m_groups;
+  // Cell-major bounds: pushes of a single box to the nearest destination of each group. Pushes
+  // of a placement are at least the sum of its boxes' bounds
+  std::vector<uint16_t> m_bounds;
+  bool m_loadedFromCache = false;
+};
+
+} // namespace soko
@@ -0,0 +1,105 @@
+#include "soko/reachability.h"
+#include "soko/util.h"
+
+namespace soko
+{
+
+Reachability::Reachability(const MapStatic &m)
+  : m_neighbours(m.rows() * m.cols())
+  , m_boxes(m.rows() * m.cols(), 0)
+  , m_visited(m.rows() * m.cols(), 0)
+  , m_distance(m.rows() * m.cols(), 0)
+{
+  checkCellIndexable(m);
+  m_stack.reserve(m_neighbours.size());
+  for (size_t i = 0; i < m.rows(); ++i)
+  {
+    for (size_t j = 0; j < m.cols(); ++j)
+    {
+      auto &neighbours = m_neighbours[i * m.cols() + j];
+      for (auto move : {Move::Left, Move::Right, Move::Up, Move::Down})
+      {
+        Pos p = Pos(i, j) + move;
+        neighbours[static_cast<size_t>(move)] = m.safeIsWall(p) ? g_noCell : toCellIndex(p, m.cols());
+      }
+    }
+  }
+}
+
+void Reachability::setBoxes(const CellIndex *boxes, size_t count)
+{
+  for (auto box : m_boxList)
+  {
+    m_boxes[box] = 0;
+  }
+  m_boxList.assign(boxes, boxes + count);
+  for (auto box : m_boxList)
+  {
+    m_boxes[box] = 1;
+  }
+}
+
+void Reachability::nextStamp() noexcept
+{
+  if (++m_stamp == 0)
+  {
+    // stamp overflow: forget all previous fills
+    std::fill(m_visited.begin(), m_visited.end(), 0);
+    m_stamp = 1;
+  }
+}
+
+CellIndex Reachability::fill(CellIndex from)
+{
+  assert(isFree(from));
+  nextStamp();
+
+  CellIndex result = from;
+  m_visited[from] = m_stamp;
+  m_stack.push_back(from);
+  while (!m_stack.empty())
+  {
+    CellIndex current = m_stack.back();
+    m_stack.pop_back();
+    for (CellIndex next : m_neighbours[current])
+    {
+      if (isFree(next) && m_visited[next] != m_stamp)
+      {
+        m_visited[next] = m_stamp;
+        result = std::min(result, next);
+        m_stack.push_back(next);
+      }
+    }
+  }
+  return result;
+}
+
+CellIndex Reachability::walk(CellIndex from)
+{
+  assert(isFree(from));
+  nextStamp();
+
+  // m_stack is used as a queue: cells are taken in the order of their distance
+  CellIndex result = from;
+  m_visited[from] = m_stamp;
+  m_distance[from] = 0;
+  m_stack.push_back(from);
+  for (size_t head = 0; head < m_stack.size(); ++head)
+  {
+    CellIndex current = m_stack[head];
+    for (CellIndex next : m_neighbours[current])
+    {
+      if (isFree(next) && m_visited[next] != m_stamp)
+      {
+        m_visited[next] = m_stamp;
+        m_distance[next] = m_distance[current] + 1;
+        result = std::min(result, next);
+        m_stack.push_back(next);
+      }
+    }
+  }
+  m_stack.clear();
+  return result;
+}
+
+} // namespace soko
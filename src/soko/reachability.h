@@ -0,0 +1,67 @@
+#pragma once
+
+#include <array>
+#include <vector>
+
+#include "soko/compact_state.h"
+#include "soko/move.h"
+
+namespace soko
+{
+
+// Flood fill of the area, reachable by the unit. All buffers are allocated once per map:
+// visited cells are marked with a fill stamp, so a fill costs only the cells it reaches.
+// Boxes are kept as cell occupancy and can be moved one by one between fills.
+class Reachability {
+public:
+  Reachability() = default;
+  explicit Reachability(const MapStatic &m);
+
+  // Neighbour cell in the direction or g_noCell for walls and map bounds
+  CellIndex neighbour(CellIndex c, Move m) const noexcept
+  {
+    return m_neighbours[c][static_cast<size_t>(m)];
+  }
+  bool isFree(CellIndex c) const noexcept { return c != g_noCell && !m_boxes[c]; }
+  bool isBox(CellIndex c) const noexcept { return m_boxes[c] != 0; }
+
+  void setBoxes(const CellIndex *boxes, size_t count);
+  void moveBox(CellIndex from, CellIndex to) noexcept
+  {
+    assert(isBox(from) && !isBox(to));
+    m_boxes[from] = 0;
+    m_boxes[to] = 1;
+  }
+
+  // Marks the area, reachable from `from`.
+  // Returns the minimal cell of the area, i.e. normalized unit position.
+  CellIndex fill(CellIndex from);
+  bool isReachable(CellIndex c) const noexcept { return m_visited[c] == m_stamp; }
+  // Same as fill, and the area gets a table of walk lengths from `from` to each of its cells:
+  // a breadth-first fill, shared by all pushes from the area
+  CellIndex walk(CellIndex from);
+  // Walk length to a reachable cell after walk()
+  uint32_t distance(CellIndex c) const noexcept
+  {
+    assert(isReachable(c));
+    return m_distance[c];
+  }
+
+  size_t cells() const noexcept { return m_neighbours.size(); }
+
+private:
+  void nextStamp() noexcept;
+
+private:
+  std::vector<std::array<CellIndex, 4>> m_neighbours;
+  // byte per cell: cheaper to access than std::vector<bool>
+  std::vector<uint8_t> m_boxes;
+  std::vector<CellIndex> m_boxList;
+
+  std::vector<uint32_t> m_visited;
+  uint32_t m_stamp = 0;
+  std::vector<CellIndex> m_stack;
+  std::vector<uint32_t> m_distance;
+};
+
+} // namespace soko
@@ -0,0 +1,222 @@
+#include "soko/search_space.h"
+
+namespace soko
+{
+
+BoxMovement restoreSingleStep(const CompactState &currentState, const CompactState &nextState,
+                              size_t cols)
+{
+  auto current = currentState.toMapState(cols).boxes;
+  auto next = nextState.toMapState(cols).boxes;
+  assert(current.size() == next.size());
+  std::vector<Pos> diffBoxes;
+  std::set_difference(current.begin(), current.end(), next.begin(), next.end(),
+                      std::back_inserter(diffBoxes));
+  assert(diffBoxes.size() == 1);
+  std::set_difference(next.begin(), next.end(), current.begin(), current.end(),
+                      std::back_inserter(diffBoxes));
+  assert(diffBoxes.size() == 2);
+
+  const Pos from = diffBoxes[0];
+  const Pos to = diffBoxes[1];
+  const size_t pushes = from.i == to.i ? std::max(from.j, to.j) - std::min(from.j, to.j)
+                                       : std::max(from.i, to.i) - std::min(from.i, to.i);
+  return {from, restoreMove(from, to), pushes};
+}
+
+std::vector<BoxMovement> restoreSteps(const NodeArena &nodes, NodeId last, size_t cols)
+{
+  std::vector<BoxMovement> result;
+  NodeId current = last;
+  NodeId previous = nodes.header(current).parent;
+  while (previous != g_noNode)
+  {
+    result.push_back(restoreSingleStep(nodes.state(previous), nodes.state(current), cols));
+    current = previous;
+    previous = nodes.header(previous).parent;
+  }
+  std::reverse(result.begin(), result.end());
+  return result;
+}
+
+SearchSpace::SearchSpace(const Map &map, bool countMoves, bool tunnelMacros)
+  : m_map(mapToMapStatic(map, &m_initial.boxes, &m_initial.unit))
+  , m_keys(m_map.rows() * m_map.cols())
+  , m_solvability(createSolvabilityMap(m_map, m_initial.boxes.size()))
+  , m_tunnels(m_map)
+  , m_reachability(m_map)
+  , m_root(m_initial, m_map.cols())
+  , m_countMoves(countMoves)
+  , m_tunnelMacros(tunnelMacros && !m_tunnels.empty())
+{
+  if (!m_countMoves)
+  {
+    m_reachability.setBoxes(m_root.boxes(), m_root.boxCount());
+    m_root.setUnit(m_reachability.fill(m_root.unit()));
+  }
+  m_rootHash = m_keys.hash(m_root);
+}
+
+bool SearchSpace::rootDeadlocked() const noexcept
+{
+  return std::any_of(m_initial.boxes.begin(), m_initial.boxes.end(),
+                     [this](Pos p) { return !m_solvability.isValid(p, m_initial); });
+}
+
+void SearchSpace::expand(const CompactState &state, StateHash hash, std::vector<Successor> &result)
+{
+  // pushes, available from the unit area
+  m_reachability.setBoxes(state.boxes(), state.boxCount());
+  if (m_countMoves)
+  {
+    m_reachability.walk(state.unit());
+  }
+  else
+  {
+    m_reachability.fill(state.unit());
+  }
+  const size_t first = result.size();
+  for (size_t i = 0; i < state.boxCount(); ++i)
+  {
+    CellIndex box = state.boxes()[i];
+    for (auto m : {Move::Left, Move::Up, Move::Right, Move::Down})
+    {
+      CellIndex unitPushPos = m_reachability.neighbour(box, reverse(m));
+      CellIndex newPos = m_reachability.neighbour(box, m);
+      if (unitPushPos != g_noCell && m_reachability.isReachable(unitPushPos) &&
+          m_reachability.isFree(newPos))
+      {
+        const uint32_t cost = m_countMoves ? m_reachability.distance(unitPushPos) + 1 : 1;
+        result.push_back({state, hash, i, box, newPos, 1, cost});
+      }
+    }
+  }
+
+  finishSuccessors(state, first, false, result);
+}
+
+std::vector<CompactState> SearchSpace::goalStates()
+{
+  MapState goal;
+  for (size_t i = 0; i < m_map.rows(); ++i)
+  {
+    for (size_t j = 0; j < m_map.cols(); ++j)
+    {
+      if (m_map.isDestination({i, j}))
+      {
+        goal.boxes.push_back({i, j});
+      }
+    }
+  }
+  goal.unit = goal.boxes.front(); // replaced by each area
+  CompactState state(goal, cols());
+  m_reachability.setBoxes(state.boxes(), state.boxCount());
+
+  std::vector<CompactState> result;
+  std::vector<bool> covered(m_reachability.cells(), false);
+  for (CellIndex c = 0; c < m_reachability.cells(); ++c)
+  {
+    if (covered[c] || m_map.isWall(toPos(c, cols())) || m_reachability.isBox(c))
+    {
+      continue;
+    }
+    state.setUnit(m_reachability.fill(c));
+    for (CellIndex other = c; other < m_reachability.cells(); ++other)
+    {
+      covered[other] = covered[other] || m_reachability.isReachable(other);
+    }
+    result.push_back(state);
+  }
+  return result;
+}
+
+void SearchSpace::expandPulls(const CompactState &state, StateHash hash,
+                              std::vector<Successor> &result)
+{
+  m_reachability.setBoxes(state.boxes(), state.boxCount());
+  m_reachability.fill(state.unit());
+  const size_t first = result.size();
+  for (size_t i = 0; i < state.boxCount(); ++i)
+  {
+    CellIndex box = state.boxes()[i];
+    for (auto m : {Move::Left, Move::Up, Move::Right, Move::Down})
+    {
+      CellIndex newPos = m_reachability.neighbour(box, m);
+      if (newPos != g_noCell && m_reachability.isReachable(newPos) &&
+          m_reachability.isFree(m_reachability.neighbour(newPos, m)))
+      {
+        result.push_back({state, hash, i, box, newPos});
+      }
+    }
+  }
+  finishSuccessors(state, first, true, result);
+}
+
+void SearchSpace::finishSuccessors(const CompactState &state, size_t first, bool pulls,
+                                   std::vector<Successor> &result)
+{
+  // unit area of each successor: box is moved for a single fill
+  for (size_t i = first; i < result.size(); ++i)
+  {
+    Successor &successor = result[i];
+    // pushing unit stands at the box's cell, pulling one is a step behind the box
+    CellIndex unit = pulls ? 2 * successor.to - successor.from : successor.from;
+    m_reachability.moveBox(successor.from, successor.to);
+    if (!pulls && m_tunnelMacros)
+    {
+      unit = pushThroughTunnel(successor);
+    }
+    successor.state.moveBox(successor.box, successor.to);
+    successor.state.setUnit(m_countMoves ? unit : m_reachability.fill(unit));
+    m_reachability.moveBox(successor.to, successor.from);
+
+    successor.hash = m_keys.moveBox(successor.hash, successor.from, successor.to);
+    successor.hash = m_keys.moveUnit(successor.hash, state.unit(), successor.state.unit());
+  }
+}
+
+CellIndex SearchSpace::pushThroughTunnel(Successor &successor)
+{
+  const Move m = restoreMove(toPos(successor.from, cols()), toPos(successor.to, cols()));
+  CellIndex unit = successor.from;
+  while (m_tunnels.isTunnel(successor.to, m))
+  {
+    const CellIndex next = m_reachability.neighbour(successor.to, m);
+    if (!m_reachability.isFree(next))
+    {
+      break;
+    }
+    m_reachability.fill(unit);
+    if (m_reachability.isReachable(next))
+    {
+      // unit can get around the box: it may be parked in the tunnel and pushed back later
+      break;
+    }
+    m_reachability.moveBox(successor.to, next);
+    unit = successor.to;
+    successor.to = next;
+    ++successor.pushes;
+    ++successor.cost;
+  }
+  return unit;
+}
+
+CompactState SearchSpace::predecessor(const CompactState &state, CellIndex from, CellIndex to)
+{
+  CompactState result = state;
+  const CellIndex *box = std::lower_bound(result.boxes(), result.boxes() + result.boxCount(), to);
+  assert(*box == to);
+  result.moveBox(static_cast<size_t>(box - result.boxes()), from);
+  const Move m = restoreMove(toPos(from, cols()), toPos(to, cols()));
+  m_reachability.setBoxes(result.boxes(), result.boxCount());
+  result.setUnit(m_reachability.fill(m_reachability.neighbour(from, reverse(m))));
+  return result;
+}
+
+bool SearchSpace::isValid(const Successor &successor, MapState &state) const
+{
+  toMapState(successor.state.cells(), successor.state.cellCount(), cols(), state);
+  return m_solvability.isValid(toPos(successor.to, cols()), state);
+}
+
+} // namespace soko
@@ -0,0 +1,111 @@
+#pragma once
+
+#include <vector>
+
+#include "soko/compact_state.h"
+#include "soko/heuristic.h"
+#include "soko/node_arena.h"
+#include "soko/reachability.h"
+#include "soko/solvability.h"
+#include "soko/tunnels.h"
+#include "soko/util.h"
+#include "soko/zobrist.h"
+
+namespace soko
+{
+
+// Box pushes between successive states of a solution: box position, direction and amount of
+// pushes. Tunnel macros push the box several times in a row
+struct BoxMovement
+{
+  Pos from;
+  Move move;
+  size_t pushes = 1;
+};
+
+// Pushes between two states, that differ by a single box position
+BoxMovement restoreSingleStep(const CompactState &currentState, const CompactState &nextState,
+                              size_t cols);
+// Pushes from the root of the node tree to the node `last`
+std::vector<BoxMovement> restoreSteps(const NodeArena &nodes, NodeId last, size_t cols);
+
+// State after a push or a tunnel macro; box with index `box` moved from `from` to `to`.
+// Cost is the pushes plus the unit walk to the first one, if moves are counted
+struct Successor
+{
+  CompactState state;
+  StateHash hash;
+  size_t box;
+  CellIndex from;
+  CellIndex to;
+  uint32_t pushes = 1;
+  uint32_t cost = 1;
+};
+
+// Push graph of a level, shared by search algorithms: states with normalized unit position,
+// their hashes, successors and deadlock checks.
+// Counting moves, states keep the exact unit position instead: the cell of the last pushed box.
+// With tunnel macros a box, pushed into a tunnel, is pushed through it as a single successor
+class SearchSpace {
+public:
+  // throws std::logic_error if the map has too many cells
+  explicit SearchSpace(const Map &map, bool countMoves = false, bool tunnelMacros = false);
+
+  const MapStatic &map() const noexcept { return m_map; }
+  size_t cols() const noexcept { return m_map.cols(); }
+  const MapState &initialState() const noexcept { return m_initial; }
+  bool countsMoves() const noexcept { return m_countMoves; }
+  const CompactState &root() const noexcept { return m_root; }
+  StateHash rootHash() const noexcept { return m_rootHash; }
+  // Some box of the initial state can't reach destination
+  bool rootDeadlocked() const noexcept;
+
+  // Appends all pushes, available in the state, to `result`. With tunnel macros pushes into
+  // tunnels are extended to the tunnel exit
+  void expand(const CompactState &state, StateHash hash, std::vector<Successor> &result);
+  // Pushed box doesn't make the successor a deadlock. `state` receives successor's MapState
+  bool isValid(const Successor &successor, MapState &state) const;
+
+  // Backward search (push graph only): states with all boxes on destinations, one for each
+  // unit area
+  std::vector<CompactState> goalStates();
+  // Appends all pulls, available in the state, to `result`: box moves to the unit cell next
+  // to it, the unit steps further in the same direction
+  void expandPulls(const CompactState &state, StateHash hash, std::vector<Successor> &result);
+  StateHash hash(const CompactState &state) const noexcept { return m_keys.hash(state); }
+  // Push graph: state, which the push or tunnel macro of a box from `from` to `to` was made in
+  CompactState predecessor(const CompactState &state, CellIndex from, CellIndex to);
+
+  BoxMove boxMove(size_t parentKey, const Successor &successor) const noexcept
+  {
+    return {parentKey, toPos(successor.from, cols()), toPos(successor.to, cols())};
+  }
+  BoxMovement boxMovement(const Successor &successor) const noexcept
+  {
+    Pos from = toPos(successor.from, cols());
+    return {from, restoreMove(from, toPos(successor.to, cols())), successor.pushes};
+  }
+
+private:
+  // Moves the box of each successor from `first` on, fills its unit area and updates hash
+  void finishSuccessors(const CompactState &state, size_t first, bool pulls,
+                        std::vector<Successor> &result);
+  // Tunnel macro: box in a tunnel is pushed further, while the unit can't get around it to the
+  // other side. Then the box has to leave the tunnel that way, and the pushes commute with
+  // everything else. Box occupancy follows the box. Returns the unit cell behind the box
+  CellIndex pushThroughTunnel(Successor &successor);
+
+private:
+  MapState m_initial;
+  MapStatic m_map;
+  ZobristKeys m_keys;
+  SolvabilityMap m_solvability;
+  Tunnels m_tunnels;
+  Reachability m_reachability;
+  CompactState m_root;
+  StateHash m_rootHash = 0;
+  bool m_countMoves;
+  bool m_tunnelMacros;
+};
+
+} // namespace soko
@@ -1,9 +1,19 @@
 #include "soko/solver.h"
-#include <unordered_set>
+#include <chrono>
 #include <set>
+#include <stdexcept>
 #include <queue>
 
-#include "soko/solvability.h"
+#include "soko/ara_star.h"
+#include "soko/bidirectional_search.h"
+#include "soko/compact_state.h"
+#include "soko/external_astar.h"
+#include "soko/greedy_search.h"
+#include "soko/hda_star.h"
+#include "soko/ida_star.h"
+#include "soko/node_arena.h"
+#include "soko/open_list.h"
+#include "soko/transposition_table.hpp"
 #include "soko/util.h"
 
 namespace soko
@@ -12,127 +22,29 @@ namespace soko
 namespace
 {
 
-template<typename T, typename Seq, typename Cmp>
-class PriorityQueue : public std::priority_queue<T, Seq, Cmp> {
-public:
-  PriorityQueue() = default;
+// Node's heuristic hasn't been calculated yet
+constexpr HeuristicValue g_notEvaluated = g_unsolvable - 1;
 
-  T extract() noexcept
-  {
-    T result = std::move(this->c.front());
-    this->pop();
-    return result;
-  }
-};
-
-size_t sizeHash(const size_t sz) noexcept
+// Box, moved between sorted box cells of two states, that differ by a single push
+BoxMove movedBox(NodeId parent, const CellIndex *from, const CellIndex *to, size_t boxes,
+                 size_t cols)
 {
-  std::hash<size_t> hash;
-  return hash(sz);
+  CellIndex moved[2];
+  std::set_difference(from, from + boxes, to, to + boxes, moved);
+  std::set_difference(to, to + boxes, from, from + boxes, moved + 1);
+  return {parent, toPos(moved[0], cols), toPos(moved[1], cols)};
 }
 
-struct SavedState
-{
-  const SavedState *prev;
-  MapState state;
-};
-
-bool operator==(const SavedState &l, const SavedState &r) noexcept
+size_t countPushes(const std::vector<BoxMovement> &res)
 {
-  return l.state.unit == r.state.unit && l.state.boxes == r.state.boxes;
-}
-
-struct SavedStateHash
-{
-  size_t operator()(const SavedState &sp) const noexcept
+  size_t result = 0;
+  for (auto &it : res)
   {
-    const MapState &s = sp.state;
-    const size_t ci = 21589;
-    const size_t cj = 1;
-    size_t hash = 0;
-    for (size_t i = 0; i < s.boxes.size(); ++i)
-    {
-      hash += (i + ci) * sizeHash(s.boxes[i].i) + (i + cj) * sizeHash(s.boxes[i].j);
-    }
-    return hash ^ (ci * sizeHash(s.unit.i) + cj * sizeHash(s.unit.j));
-  }
-};
-
-
-struct QueuedState
-{
-  QueuedState(const SavedState &state, const Heuristic &h, size_t nMove)
-    : calculatedHeuristics(h(state.state))
-    , associatedState(&state)
-    , nMove(nMove)
-  {}
-
-  size_t calculatedHeuristics;
-  const SavedState *associatedState;
-  size_t nMove;
-};
-
-struct CalculatedStateComparator
-{
-  // Greater
-  bool operator()(const QueuedState &left, const QueuedState &right) const
-  {
-    return left.nMove + left.calculatedHeuristics > right.nMove + right.calculatedHeuristics;
+    result += it.pushes;
   }
-};
-
-
-// Units are placed into fixed (i->0, j->0) places for easier MapState comparing
-Pos topLeft(const Mat<bool> &unitMap)
-{
-  auto it = std::find(unitMap.begin(), unitMap.end(), true);
-  assert(it != unitMap.end());
-  return unitMap.iteratorToPos(it);
-}
-
-std::vector<Pos> moveBox(const std::vector<Pos> &other, size_t oldIdx, Pos newPos)
-{
-  std::vector<Pos> result = other;
-  result.erase(result.begin() + oldIdx);
-  result.insert(std::upper_bound(result.begin(), result.end(), newPos), newPos);
-  return result;
-}
-
-using BoxMovement = std::pair<Pos, Move>;
-
-BoxMovement restoreSingleStep(const MapState &currentState, const MapState &nextState)
-{
-  auto &current = currentState.boxes;
-  auto &next = nextState.boxes;
-  assert(current.size() == next.size());
-  std::vector<Pos> diffBoxes;
-  std::set_difference(current.begin(), current.end(), next.begin(), next.end(),
-                      std::back_inserter(diffBoxes));
-  assert(diffBoxes.size() == 1);
-  std::set_difference(next.begin(), next.end(), current.begin(), current.end(),
-                      std::back_inserter(diffBoxes));
-  assert(diffBoxes.size() == 2);
-
-  return {diffBoxes[0], restoreMove(diffBoxes[0], diffBoxes[1])};
-}
-
-std::vector<BoxMovement> restoreSteps(const SavedState &last)
-{
-  assert(last.prev != nullptr);
-  std::vector<BoxMovement> result;
-  const SavedState *current = &last;
-  const SavedState *previous = current->prev;
-  while (previous != nullptr)
-  {
-    result.push_back(restoreSingleStep(previous->state, current->state));
-    current = previous;
-    previous = previous->prev;
-  }
-  std::reverse(result.begin(), result.end());
   return result;
 }
 
-
 std::vector<Move> changeRepresentation(const std::vector<BoxMovement> &res, const Map &originalMap)
 {
   Map map = originalMap;
@@ -140,20 +52,25 @@ std::vector<Move> changeRepresentation(const std::vector<BoxMovement> &res, cons
 
   for (auto it : res)
   {
-    Pos boxFrom = it.first;
-    Move m = it.second;
-    Pos boxTo = boxFrom + m;
+    Pos boxFrom = it.from;
+    Move m = it.move;
     Pos unitBeforePush = boxFrom - m;
 
     auto local = unitPathTo(map, unitBeforePush);
     std::copy(local.begin(), local.end(), std::back_inserter(result));
 
-    extractUnit(map);
-    Cell boxFromCell = removeItem(map.at(boxFrom), Cell::Box);
-    boxFromCell = placeItem(boxFromCell, Cell::Unit);
-    map.at(boxFrom) = boxFromCell;
-    map.at(boxTo) = placeItem(map.at(boxTo), Cell::Box);
-    result.push_back(m);
+    // tunnel macro is expanded to single pushes
+    for (size_t i = 0; i < it.pushes; ++i)
+    {
+      Pos boxTo = boxFrom + m;
+      extractUnit(map);
+      Cell boxFromCell = removeItem(map.at(boxFrom), Cell::Box);
+      boxFromCell = placeItem(boxFromCell, Cell::Unit);
+      map.at(boxFrom) = boxFromCell;
+      map.at(boxTo) = placeItem(map.at(boxTo), Cell::Box);
+      result.push_back(m);
+      boxFrom = boxTo;
+    }
   }
 
   return result;
@@ -166,77 +83,399 @@ void Solver::solve(const Map &originalMap)
 {
   assert(m_heuristic.get() != nullptr);
   m_solved = SolveState::Solving;
+  m_statistics = {};
+  const auto initStart = std::chrono::steady_clock::now();
   m_heuristic->init(originalMap);
+  m_statistics.heuristicInitSeconds =
+      std::chrono::duration<double>(std::chrono::steady_clock::now() - initStart).count();
+  m_statistics.heuristicBytes = m_heuristic->bytes();
+  const bool optimal = m_config.optimality != Optimality::None;
+  if (optimal && !m_heuristic->admissible())
+  {
+    m_solved = SolveState::NotSolved;
+    throw std::logic_error("Heuristic " + m_heuristic->name() + " can't find optimal solutions");
+  }
 
-  MapState originalState;
-  const MapStatic map = mapToMapStatic(originalMap, &originalState.boxes, &originalState.unit);
-
-  std::unordered_set<SavedState, SavedStateHash> possibleStates;
-  PriorityQueue<QueuedState, std::deque<QueuedState>, CalculatedStateComparator> toBeWatched;
+  SearchSpace space(originalMap, m_config.optimality == Optimality::Moves,
+                    m_config.tunnelMacros && !optimal);
+  std::vector<BoxMovement> boxMoves;
+  bool solved = false;
+  if (!space.rootDeadlocked())
+  {
+    switch (optimal ? SearchAlgorithm::AStar : m_config.algorithm)
+    {
+    case SearchAlgorithm::AStar:
+      if (m_config.openList == OpenListType::BucketQueue)
+      {
+        BucketQueue toBeWatched;
+        solved = search(space, toBeWatched, boxMoves);
+      }
+      else
+      {
+        BinaryHeapQueue toBeWatched;
+        solved = search(space, toBeWatched, boxMoves);
+      }
+      break;
+    case SearchAlgorithm::IdaStar:
+      solved = IdaStar(space, *m_heuristic, m_config, m_statistics).solve(boxMoves);
+      break;
+    case SearchAlgorithm::HdaStar:
+      solved = HdaStar(originalMap, *m_heuristic, m_config, m_statistics).solve(boxMoves);
+      break;
+    case SearchAlgorithm::Bidirectional:
+      solved = BidirectionalSearch(space, *m_heuristic, m_config, m_statistics).solve(boxMoves);
+      break;
+    case SearchAlgorithm::AraStar:
+      solved = AraStar(space, *m_heuristic, m_config, m_statistics)
+                   .solve([&](const std::vector<BoxMovement> &solution, double bound) {
+                     boxMoves = solution;
+                     m_boxMovements = countPushes(solution);
+                     m_result = changeRepresentation(solution, originalMap);
+                     if (m_onSolution)
+                     {
+                       m_onSolution(m_result, bound);
+                     }
+                   });
+      break;
+    case SearchAlgorithm::Greedy:
+    case SearchAlgorithm::Beam:
+      solved = GreedySearch(space, *m_heuristic, m_config, m_statistics).solve(boxMoves);
+      break;
+    case SearchAlgorithm::ExternalAStar:
+      solved = ExternalAStar(space, *m_heuristic, m_config, m_statistics).solve(boxMoves);
+      break;
+    }
+  }
 
-  auto solvabilityMap = createSolvabilityMap(map, originalState.boxes.size());
-  Mat<bool> unitMap = drawUnitMap(map, originalState.unit, originalState.boxes);
-  possibleStates.insert({nullptr, {originalState.boxes, topLeft(unitMap)}});
+  if (solved)
+  {
+    m_boxMovements = countPushes(boxMoves);
+    m_result = changeRepresentation(boxMoves, originalMap);
+    m_solved = SolveState::Solved;
+  }
+  else
+  {
+    m_solved = SolveState::NotSolved;
+  }
+}
 
-  if (std::any_of(originalState.boxes.begin(), originalState.boxes.end(),
-                  [&solvabilityMap, originalState](Pos p) {
-                    return !solvabilityMap.isValid(p, originalState);
-                  }))
+template<typename OpenList>
+bool Solver::search(SearchSpace &space, OpenList &toBeWatched, std::vector<BoxMovement> &result)
+{
+  if (m_config.evaluationThreads != 0 && !m_config.lazyHeuristic)
+  {
+    return searchBatched(space, toBeWatched, result);
+  }
+  const size_t cols = space.cols();
+  NodeArena &nodes = m_nodes;
+  nodes.reset(space.root().cellCount());
+  TranspositionTable<NodeId> possibleStates;
+  auto insertState = [&nodes, &possibleStates](NodeId prev, const CompactState &state,
+                                               StateHash hash, uint32_t g) {
+    return possibleStates.findOrInsert(
+        hash, [&](NodeId n) { return nodes.equal(n, state); },
+        [&]() { return nodes.allocate(prev, hash, state.cells(), g); });
+  };
+  insertState(g_noNode, space.root(), space.rootHash(), 0);
+
+  auto evaluate = [this](const MapState &state, NodeId node, const BoxMove *move) {
+    ++m_statistics.heuristicCalls;
+    return move ? m_heuristic->evaluate(state, node, *move) : m_heuristic->evaluate(state, node);
+  };
+  const HeuristicValue originalH = evaluate(space.initialState(), 0, nullptr);
+  if (originalH == g_unsolvable)
+  {
+    return false;
+  }
+  toBeWatched.push(0, 0, originalH);
+
+  // Lazy mode: exact heuristic of each node, calculated when the node is popped for the first time.
+  // Successors are queued with the parent's h less their pushes or with the heuristic's lower
+  // bound, whichever is greater. A push may lower the heuristic by more than one, but the
+  // estimate stays admissible: the successor's pushes to solve are at least the parent's less
+  // the pushes between them, and the parent's are at least its admissible h.
+  const bool lazy = m_config.lazyHeuristic;
+  const bool reopen = m_config.reopenNodes || m_config.optimality != Optimality::None;
+  std::vector<HeuristicValue> heuristics;
+  if (lazy)
   {
-    return;
+    heuristics.push_back(originalH);
   }
 
-  toBeWatched.emplace(*possibleStates.begin(), *m_heuristic, 0);
+  // Partial expansion: successors, which bound of f exceeds the node's f, wait for the node
+  // to be popped again with the least of their bounds. Entry h of a requeued node is f less g
+  const bool partial = m_config.partialExpansion && !lazy;
+
+  std::vector<Successor> successors;
+  MapState newState;
+  bool solved = false;
 
   while (!toBeWatched.empty())
   {
-    auto calculatedState = toBeWatched.extract();
-    if (calculatedState.calculatedHeuristics == 0)
+    const OpenEntry calculatedState = toBeWatched.pop();
+    if (calculatedState.g != nodes.header(calculatedState.node).g)
+    {
+      // node was reopened with fewer pushes after the entry had been queued
+      continue;
+    }
+    if (lazy)
+    {
+      const NodeId node = calculatedState.node;
+      HeuristicValue &h = heuristics[node];
+      if (h == g_notEvaluated)
+      {
+        const NodeId parent = nodes.header(node).parent;
+        BoxMove move = movedBox(parent, nodes.cells(parent), nodes.cells(node), nodes.cellCount() - 1,
+                                cols);
+        h = evaluate(nodes.state(node).toMapState(cols), node, &move);
+      }
+      if (h == g_unsolvable)
+      {
+        continue;
+      }
+      if (h > calculatedState.h)
+      {
+        toBeWatched.push(calculatedState.node, calculatedState.g, h);
+        continue;
+      }
+    }
+    if (calculatedState.h == 0)
+    {
+      result = restoreSteps(nodes, calculatedState.node, cols);
+      solved = true;
+      break;
+    }
+    if (m_config.maxNodes != 0 && nodes.size() >= m_config.maxNodes)
     {
-      auto boxMoves = restoreSteps(*calculatedState.associatedState);
-      m_boxMovements = boxMoves.size();
-      m_result = changeRepresentation(boxMoves, originalMap);
-      m_solved = SolveState::Solved;
       break;
     }
 
-    auto &state = calculatedState.associatedState->state;
-    unitMap = drawUnitMap(map, state.unit, state.boxes); // called twice :(
+    ++m_statistics.expanded;
+    const NodeId current = calculatedState.node;
+    successors.clear();
+    space.expand(nodes.state(current), nodes.header(current).hash, successors);
+    m_statistics.generated += successors.size();
 
-    for (size_t i = 0; i < state.boxes.size(); ++i)
+    size_t nextF = g_inf;
+    for (auto &successor : successors)
     {
-      auto &box = state.boxes[i];
-      for (auto m : {Move::Left, Move::Up, Move::Right, Move::Down})
+      const uint32_t newG = static_cast<uint32_t>(calculatedState.g + successor.cost);
+      bool valid = true;
+      if (partial)
       {
-        Pos unitPushPos = box - m;
-        if (!unitMap.contains(unitPushPos) || !unitMap.at(unitPushPos))
+        valid = space.isValid(successor, newState);
+        const HeuristicValue bound =
+            valid ? m_heuristic->lowerBound(newState, space.boxMove(current, successor))
+                  : g_unsolvable;
+        if (bound != g_unsolvable && size_t(newG) + bound > calculatedState.f())
         {
+          nextF = std::min(nextF, size_t(newG) + bound);
+          ++m_statistics.deferred;
           continue;
         }
-        auto newPos = box + m;
-        if (!safeIsFree(map, newPos, state.boxes))
+      }
+      auto inserted = insertState(current, successor.state, successor.hash, newG);
+      if (!inserted.second)
+      {
+        NodeHeader &header = nodes.header(*inserted.first);
+        if (!reopen || header.g <= newG)
         {
           continue;
         }
+        header.g = newG;
+        header.parent = current;
+        ++m_statistics.reopened;
+      }
+      else if (lazy)
+      {
+        heuristics.push_back(g_notEvaluated);
+      }
+      if (!valid || (!partial && !space.isValid(successor, newState)))
+      {
+        continue;
+      }
+      if (lazy)
+      {
+        HeuristicValue h = heuristics[*inserted.first];
+        if (h == g_notEvaluated)
+        {
+          h = std::max<HeuristicValue>(
+              calculatedState.h - std::min<size_t>(calculatedState.h, successor.pushes),
+              m_heuristic->lowerBound(newState));
+        }
+        if (h != g_unsolvable)
+        {
+          toBeWatched.push(*inserted.first, newG, h);
+        }
+        continue;
+      }
+      BoxMove move = space.boxMove(current, successor);
+      const HeuristicValue h = evaluate(newState, *inserted.first, &move);
+      if (h != g_unsolvable)
+      {
+        toBeWatched.push(*inserted.first, newG, h);
+      }
+    }
+    if (nextF != g_inf)
+    {
+      toBeWatched.push(current, calculatedState.g, nextF - calculatedState.g);
+    }
+  }
+  m_statistics.closedSet = possibleStates.statistics();
+  m_statistics.nodes = nodes.size();
+  m_statistics.arenaBytes = nodes.bytesUsed();
+  return solved;
+}
 
-        auto newBoxes = moveBox(state.boxes, i, newPos);
-        Pos newUnit = box;
-        auto newUnitMap = drawUnitMap(map, newUnit, newBoxes);
-        newUnit = topLeft(newUnitMap);
+template<typename OpenList>
+bool Solver::searchBatched(SearchSpace &space, OpenList &toBeWatched,
+                           std::vector<BoxMovement> &result)
+{
+  const size_t workers = m_config.evaluationThreads;
+  if (!m_pool || m_pool->workers() != workers)
+  {
+    m_pool = std::make_unique<ThreadPool>(workers);
+  }
+  m_workerHeuristics.clear();
+  for (size_t i = 0; i < workers; ++i)
+  {
+    m_workerHeuristics.push_back(m_heuristic->clone());
+  }
 
-        auto inserted = possibleStates.insert(
-            {calculatedState.associatedState, {std::move(newBoxes), newUnit}});
-        if (inserted.second && solvabilityMap.isValid(newPos, inserted.first->state))
+  const size_t cols = space.cols();
+  NodeArena &nodes = m_nodes;
+  nodes.reset(space.root().cellCount());
+  TranspositionTable<NodeId> possibleStates;
+  auto insertState = [&nodes, &possibleStates](NodeId prev, const CompactState &state,
+                                               StateHash hash, uint32_t g) {
+    return possibleStates.findOrInsert(
+        hash, [&](NodeId n) { return nodes.equal(n, state); },
+        [&]() { return nodes.allocate(prev, hash, state.cells(), g); });
+  };
+  insertState(g_noNode, space.root(), space.rootHash(), 0);
+
+  ++m_statistics.heuristicCalls;
+  const HeuristicValue originalH = m_heuristic->evaluate(space.initialState(), 0);
+  if (originalH == g_unsolvable)
+  {
+    return false;
+  }
+  toBeWatched.push(0, 0, originalH);
+
+  std::vector<Successor> successors;
+  std::vector<Candidate> candidates;
+  std::vector<MapState> states(workers);
+  std::vector<size_t> calls(workers, 0);
+  size_t parts = 0;
+  // worker, which evaluated the node; root is evaluated by the solver's heuristic
+  std::vector<uint32_t> evaluatedBy = {static_cast<uint32_t>(workers)};
+  const size_t batchNodes = std::max<size_t>(m_config.batchNodes, 1);
+  const bool reopen = m_config.reopenNodes || m_config.optimality != Optimality::None;
+
+  // Each worker takes a contiguous part of the batch. Siblings are evaluated by repairing
+  // the parent's assignment, so a parent, evaluated by another worker, is evaluated again,
+  // unless the worker gets a single child of it
+  auto evaluate = [&](size_t worker, size_t part) {
+    Heuristic &heuristic = *m_workerHeuristics[worker];
+    MapState &state = states[worker];
+    const size_t end = (part + 1) * candidates.size() / parts;
+    NodeId evaluatedParent = g_noNode;
+    for (size_t i = part * candidates.size() / parts; i < end; ++i)
+    {
+      Candidate &candidate = candidates[i];
+      if (!space.isValid(candidate.successor, state))
+      {
+        candidate.h = g_unsolvable;
+        continue;
+      }
+      if (candidate.parent != evaluatedParent && evaluatedBy[candidate.parent] != worker &&
+          i + 1 < end && candidates[i + 1].parent == candidate.parent)
+      {
+        heuristic.evaluate(nodes.state(candidate.parent).toMapState(cols), candidate.parent);
+        evaluatedParent = candidate.parent;
+        ++calls[worker];
+      }
+      candidate.h = heuristic.evaluate(state, candidate.node,
+                                       space.boxMove(candidate.parent, candidate.successor));
+      candidate.worker = static_cast<uint32_t>(worker);
+      ++calls[worker];
+    }
+  };
+
+  bool solved = false;
+  bool stopped = false;
+  while (!toBeWatched.empty() && !solved && !stopped)
+  {
+    candidates.clear();
+    for (size_t popped = 0; popped < batchNodes && !toBeWatched.empty();)
+    {
+      const OpenEntry calculatedState = toBeWatched.pop();
+      if (calculatedState.g != nodes.header(calculatedState.node).g)
+      {
+        continue;
+      }
+      if (calculatedState.h == 0)
+      {
+        result = restoreSteps(nodes, calculatedState.node, cols);
+        solved = true;
+        break;
+      }
+      if (m_config.maxNodes != 0 && nodes.size() >= m_config.maxNodes)
+      {
+        stopped = true;
+        break;
+      }
+
+      ++popped;
+      ++m_statistics.expanded;
+      const NodeId current = calculatedState.node;
+      successors.clear();
+      space.expand(nodes.state(current), nodes.header(current).hash, successors);
+      m_statistics.generated += successors.size();
+      for (auto &successor : successors)
+      {
+        const uint32_t newG = static_cast<uint32_t>(calculatedState.g + successor.cost);
+        auto inserted = insertState(current, successor.state, successor.hash, newG);
+        if (!inserted.second)
         {
-          toBeWatched.emplace(*inserted.first, *m_heuristic, calculatedState.nMove + 1);
+          NodeHeader &header = nodes.header(*inserted.first);
+          if (!reopen || header.g <= newG)
+          {
+            continue;
+          }
+          header.g = newG;
+          header.parent = current;
+          ++m_statistics.reopened;
         }
+        candidates.push_back({successor, current, *inserted.first, newG, 0, 0});
+      }
+    }
+    if (solved || stopped)
+    {
+      break;
+    }
+
+    parts = std::min(workers, candidates.size());
+    m_pool->run(parts, evaluate);
+    // open list gets the batch in the order of generation, whatever worker evaluated it
+    evaluatedBy.resize(nodes.size());
+    for (auto &candidate : candidates)
+    {
+      evaluatedBy[candidate.node] = candidate.worker;
+      if (candidate.h != g_unsolvable)
+      {
+        toBeWatched.push(candidate.node, candidate.g, candidate.h);
       }
     }
   }
-  if (m_solved == SolveState::Solving)
+  for (size_t count : calls)
   {
-    m_solved = SolveState::NotSolved;
+    m_statistics.heuristicCalls += count;
   }
+  m_statistics.closedSet = possibleStates.statistics();
+  m_statistics.nodes = nodes.size();
+  m_statistics.arenaBytes = nodes.bytesUsed();
+  return solved;
 }
 
 } // namespace soko
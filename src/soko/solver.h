@@ -2,7 +2,13 @@
 #include "soko/map.h"
 #include "soko/move.h"
 #include "soko/heuristic.h"
+#include "soko/node_arena.h"
+#include "soko/search_space.h"
+#include "soko/thread_pool.h"
+#include "soko/transposition_table.hpp"
+#include <functional>
 #include <memory>
+#include <string>
 
 namespace soko
 {
@@ -14,8 +20,130 @@ enum class SolveState
   Solved
 };
 
+enum class SearchAlgorithm
+{
+  AStar,
+  // iterative deepening A*: memory is bounded by SolverConfig::tableBytes
+  IdaStar,
+  // hash distributed A*: states are divided between SolverConfig::threads threads
+  HdaStar,
+  // forward push search and backward pull search from the goal states
+  Bidirectional,
+  // anytime repairing A*: weighted A*, improving its solution with decreasing weight
+  AraStar,
+  // fast incomplete modes: best-first search by h only and beam search, bounded by
+  // SolverConfig::beamWidth
+  Greedy,
+  Beam,
+  // A* with open and closed lists in scratch files, see SolverConfig::scratchDirectory
+  ExternalAStar,
+};
+
+enum class Optimality
+{
+  // first found solution of the configured search
+  None,
+  // minimal pushes: A* with node reopening and an admissible heuristic
+  Pushes,
+  // minimal moves, pushes included: A* over pushes, each one costs the unit walk to the box
+  // and the push itself. States keep exact unit positions
+  Moves,
+};
+
+enum class OpenListType
+{
+  BucketQueue,
+  BinaryHeap,
+};
+
+struct SolverConfig
+{
+  // Optimal modes always run A* with node reopening and single pushes, whatever the algorithm,
+  // reopenNodes and tunnelMacros are. Solver throws std::logic_error, if the heuristic isn't
+  // admissible
+  Optimality optimality = Optimality::None;
+  SearchAlgorithm algorithm = SearchAlgorithm::AStar;
+  OpenListType openList = OpenListType::BucketQueue;
+  // Search gives up, when amount of stored nodes (expanded nodes for IDA*) reaches the limit.
+  // 0 means no limit
+  size_t maxNodes = 0;
+  // Stored node, reached again with fewer pushes, gets the new path and goes back to the open
+  // list. Otherwise the first found path to a node is kept. ARA* always keeps the better paths,
+  // its suboptimality bound relies on them
+  bool reopenNodes = true;
+  // Heuristic of a node is calculated, when it's popped from the open list, rather than
+  // for every generated successor
+  bool lazyHeuristic = false;
+  // Enhanced partial expansion (EPEA*): an expanded node stores only successors, which cheap
+  // bound of f doesn't exceed the node's f, and goes back to the open list with the least
+  // bound of the rest. Ignored in lazy mode and with evaluation threads
+  bool partialExpansion = false;
+  // Box, pushed into a one cell wide corridor, is pushed through it by a single successor
+  bool tunnelMacros = true;
+  // IDA*: memory of the transposition table
+  size_t tableBytes = size_t(64) << 20;
+  // HDA*: search threads, 0 means a thread per hardware thread. HDA* always uses bucket queues
+  // and evaluates every generated successor
+  size_t threads = 0;
+  // A*: successors of `batchNodes` popped nodes are evaluated as a batch by `evaluationThreads`
+  // workers, the search thread included. 0 threads: successors are evaluated one by one.
+  // Ignored in lazy mode
+  size_t evaluationThreads = 0;
+  size_t batchNodes = 1;
+  // ARA*: weight of the heuristic in the first search. After every solution the weight
+  // decreases by `weightStep` down to 1; 0 step stops at the first solution (weighted A*).
+  // Improved nodes are always reopened
+  double weight = 3;
+  double weightStep = 0.5;
+  // Beam search: successors, kept in each layer. Wider beam needs more memory and misses
+  // fewer solutions
+  size_t beamWidth = 1000;
+  // External A*: directory for the scratch files, empty means the system temporary directory.
+  // Buckets of the open list are sorted in runs of `runBytes` memory
+  std::string scratchDirectory;
+  size_t runBytes = size_t(64) << 20;
+};
+
+struct SolverStatistics
+{
+  // stored search nodes and bytes, occupied by them in the node arena (A*)
+  size_t nodes = 0;
+  size_t arenaBytes = 0;
+  // expanded nodes, generated successors (stored ones included) and
+  // stored nodes, reached again with fewer pushes
+  size_t expanded = 0;
+  size_t generated = 0;
+  size_t reopened = 0;
+  size_t heuristicCalls = 0;
+  // precomputation of the heuristic by init: time and bytes of its tables
+  double heuristicInitSeconds = 0;
+  size_t heuristicBytes = 0;
+  // EPEA*: successors, left for a later expansion of their parent (again and again)
+  size_t deferred = 0;
+  // IDA*: searches with increasing f bound, ARA*: searches with decreasing weight,
+  // beam search: expanded layers
+  size_t iterations = 0;
+  // HDA*: successors, sent to the threads, which own them
+  size_t messages = 0;
+  // bidirectional search: nodes of the pull search, included into `nodes`
+  size_t backwardNodes = 0;
+  // ARA*: found solutions and the proven bound of the last one's suboptimality: it's at most
+  // `suboptimality` times longer than the optimal solution. The bound never grows from one
+  // solution to the next and is 1 for the last one, unless the search is stopped
+  size_t solutions = 0;
+  double suboptimality = 0;
+  // external A*: bytes, written to the scratch files
+  size_t scratchBytes = 0;
+  // A* closed set or IDA* bounded transposition table
+  TranspositionTableStatistics closedSet;
+};
+
 class Solver {
 public:
+  // Anytime search reports every improved solution: moves and its suboptimality bound.
+  // result() and boxMovements() already return the solution during the call
+  using SolutionCallback = std::function<void(const std::vector<Move> &moves, double bound)>;
+
   Solver()
     : m_solved(SolveState::NotSolved)
   {}
@@ -24,17 +152,50 @@ public:
   // TODO: add pause, single step, watch current state
   void solve(const Map &map);
   void setHeuristic(std::unique_ptr<Heuristic> &&h) noexcept { m_heuristic = std::move(h); }
+  void setConfig(const SolverConfig &config) noexcept { m_config = config; }
+  void setSolutionCallback(SolutionCallback callback) { m_onSolution = std::move(callback); }
+  const SolverConfig &config() const noexcept { return m_config; }
   SolveState solved() const noexcept { return m_solved; }
   const std::vector<Move> &result() const noexcept { return m_result; }
   size_t boxMovements() const noexcept { return m_boxMovements; }
   const Heuristic *heuristic() const noexcept { return m_heuristic.get(); }
-  void reset() noexcept { m_solved = SolveState::NotSolved; }
+  const SolverStatistics &statistics() const noexcept { return m_statistics; }
+  void reset() noexcept
+  {
+    m_solved = SolveState::NotSolved;
+    m_nodes.reset();
+  }
+
+private:
+  template<typename OpenList>
+  bool search(SearchSpace &space, OpenList &toBeWatched, std::vector<BoxMovement> &result);
+  template<typename OpenList>
+  bool searchBatched(SearchSpace &space, OpenList &toBeWatched, std::vector<BoxMovement> &result);
+
+  // successor, inserted into the closed set, which waits for the batch evaluation
+  struct Candidate
+  {
+    Successor successor;
+    NodeId parent;
+    NodeId node;
+    uint32_t g;
+    HeuristicValue h;
+    // worker, which heuristic keeps data of the node
+    uint32_t worker;
+  };
 
 private:
   std::unique_ptr<Heuristic> m_heuristic;
+  SolverConfig m_config;
+  SolutionCallback m_onSolution;
   SolveState m_solved;
   size_t m_boxMovements;
   std::vector<Move> m_result;
+  SolverStatistics m_statistics;
+  NodeArena m_nodes;
+  // batch evaluation: persistent workers and a heuristic copy for each of them
+  std::unique_ptr<ThreadPool> m_pool;
+  std::vector<std::unique_ptr<Heuristic>> m_workerHeuristics;
 };
 
 } // namespace soko
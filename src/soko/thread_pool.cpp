@@ -0,0 +1,80 @@
+#include "soko/thread_pool.h"
+
+#include <cassert>
+
+namespace soko
+{
+
+ThreadPool::ThreadPool(size_t workers)
+{
+  assert(workers != 0);
+  for (size_t i = 1; i < workers; ++i)
+  {
+    m_threads.emplace_back(&ThreadPool::work, this, i);
+  }
+}
+
+ThreadPool::~ThreadPool()
+{
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_exit = true;
+  }
+  m_started.notify_all();
+  for (auto &thread : m_threads)
+  {
+    thread.join();
+  }
+}
+
+void ThreadPool::run(size_t count, const Task &task)
+{
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_task = &task;
+    m_count = count;
+    m_next = 0;
+    m_busy = m_threads.size();
+    ++m_generation;
+  }
+  m_started.notify_all();
+  process(0);
+
+  std::unique_lock<std::mutex> lock(m_mutex);
+  m_finished.wait(lock, [this]() { return m_busy == 0; });
+  m_task = nullptr;
+}
+
+void ThreadPool::work(size_t worker)
+{
+  size_t generation = 0;
+  while (true)
+  {
+    {
+      std::unique_lock<std::mutex> lock(m_mutex);
+      m_started.wait(lock, [&]() { return m_exit || m_generation != generation; });
+      if (m_exit)
+      {
+        return;
+      }
+      generation = m_generation;
+    }
+    process(worker);
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (--m_busy == 0)
+    {
+      m_finished.notify_one();
+    }
+  }
+}
+
+void ThreadPool::process(size_t worker)
+{
+  for (size_t i = m_next++; i < m_count; i = m_next++)
+  {
+    (*m_task)(worker, i);
+  }
+}
+
+} // namespace soko
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace soko
+{
+
+// Persistent threads, running batches of independent tasks. The calling thread takes part in
+// every batch as worker 0, so a pool of a single worker has no threads at all.
+class ThreadPool {
+public:
+  using Task = std::function<void(size_t worker, size_t index)>;
+
+  // `workers` includes the calling thread
+  explicit ThreadPool(size_t workers);
+  ThreadPool(const ThreadPool &) = delete;
+  ThreadPool &operator=(const ThreadPool &) = delete;
+  ~ThreadPool();
+
+  size_t workers() const noexcept { return m_threads.size() + 1; }
+  // Calls task(worker, index) for every index in [0, count). Returns, when all calls are done
+  void run(size_t count, const Task &task);
+
+private:
+  void work(size_t worker);
+  void process(size_t worker);
+
+private:
+  std::vector<std::thread> m_threads;
+  std::mutex m_mutex;
+  std::condition_variable m_started;
+  std::condition_variable m_finished;
+  // batch, being run
+  const Task *m_task = nullptr;
+  size_t m_count = 0;
+  size_t m_generation = 0;
+  std::atomic<size_t> m_next{0};
+  // threads, which haven't finished the batch yet
+  size_t m_busy = 0;
+  bool m_exit = false;
+};
+
+} // namespace soko
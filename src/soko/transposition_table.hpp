@@ -0,0 +1,237 @@
+#pragma once
+
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+#include "soko/zobrist.h"
+
+namespace soko
+{
+
+struct TranspositionTableStatistics
+{
+  size_t size = 0;
+  size_t capacity = 0;
+  size_t resizes = 0;
+  size_t lookups = 0;
+  // slots inspected by all lookups
+  size_t probes = 0;
+  size_t maxProbeLength = 0;
+  // bounded table: lookups, that found the hash, and entries, overwritten by other hashes
+  size_t hits = 0;
+  size_t replacements = 0;
+
+  double loadFactor() const noexcept
+  {
+    return capacity == 0 ? 0. : static_cast<double>(size) / capacity;
+  }
+  double averageProbeLength() const noexcept
+  {
+    return lookups == 0 ? 0. : static_cast<double>(probes) / lookups;
+  }
+  // Statistics of several tables
+  void merge(const TranspositionTableStatistics &other) noexcept
+  {
+    size += other.size;
+    capacity += other.capacity;
+    resizes += other.resizes;
+    lookups += other.lookups;
+    probes += other.probes;
+    maxProbeLength = std::max(maxProbeLength, other.maxProbeLength);
+    hits += other.hits;
+    replacements += other.replacements;
+  }
+};
+
+// Open-addressing hash table with linear probing, used as a closed set of the search.
+// Slots keep full state hashes, so almost all mismatches are rejected without touching values.
+// Capacity is a power of two; the table doubles when load factor exceeds maxLoadFactor.
+// Pointers to values are invalidated by insertions.
+template<typename T>
+class TranspositionTable {
+public:
+  explicit TranspositionTable(size_t capacity = 1024, double maxLoadFactor = 0.75)
+    : m_maxLoadFactor(maxLoadFactor)
+  {
+    assert(maxLoadFactor > 0 && maxLoadFactor < 1);
+    size_t powerOfTwo = 16;
+    while (powerOfTwo < capacity)
+    {
+      powerOfTwo *= 2;
+    }
+    m_slots.resize(powerOfTwo);
+    m_stats.capacity = powerOfTwo;
+  }
+
+  // Looks up a value, for which equal(value) holds. If nothing is found, value returned by
+  // create() is inserted. Returns pointer to the value and true if insertion took place.
+  template<typename Equal, typename Create>
+  std::pair<T *, bool> findOrInsert(StateHash hash, Equal &&equal, Create &&create)
+  {
+    if (m_stats.size + 1 > m_maxLoadFactor * m_slots.size())
+    {
+      grow();
+    }
+    hash = normalize(hash);
+    Slot *slot = probe(hash, equal);
+    if (slot->hash == hash)
+    {
+      return {&slot->value, false};
+    }
+    slot->hash = hash;
+    slot->value = create();
+    ++m_stats.size;
+    return {&slot->value, true};
+  }
+
+  template<typename Equal>
+  T *find(StateHash hash, Equal &&equal)
+  {
+    hash = normalize(hash);
+    Slot *slot = probe(hash, equal);
+    return slot->hash == hash ? &slot->value : nullptr;
+  }
+
+  void clear()
+  {
+    for (auto &slot : m_slots)
+    {
+      slot.hash = g_empty;
+    }
+    m_stats.size = 0;
+  }
+
+  size_t size() const noexcept { return m_stats.size; }
+  size_t memoryUsage() const noexcept { return m_slots.size() * sizeof(Slot); }
+  const TranspositionTableStatistics &statistics() const noexcept { return m_stats; }
+
+private:
+  static constexpr StateHash g_empty = 0;
+
+  struct Slot
+  {
+    StateHash hash = g_empty;
+    T value;
+  };
+
+  static StateHash normalize(StateHash hash) noexcept { return hash == g_empty ? 1 : hash; }
+
+  // Returns either the slot with equal value or the empty slot, where the value belongs
+  template<typename Equal>
+  Slot *probe(StateHash hash, Equal &equal)
+  {
+    const size_t mask = m_slots.size() - 1;
+    size_t length = 1;
+    size_t i = static_cast<size_t>(hash) & mask;
+    while (m_slots[i].hash != g_empty && (m_slots[i].hash != hash || !equal(m_slots[i].value)))
+    {
+      i = (i + 1) & mask;
+      ++length;
+    }
+    ++m_stats.lookups;
+    m_stats.probes += length;
+    m_stats.maxProbeLength = std::max(m_stats.maxProbeLength, length);
+    return &m_slots[i];
+  }
+
+  void grow()
+  {
+    std::vector<Slot> old(m_slots.size() * 2);
+    old.swap(m_slots);
+    const size_t mask = m_slots.size() - 1;
+    for (auto &slot : old)
+    {
+      if (slot.hash == g_empty)
+      {
+        continue;
+      }
+      size_t i = static_cast<size_t>(slot.hash) & mask;
+      while (m_slots[i].hash != g_empty)
+      {
+        i = (i + 1) & mask;
+      }
+      m_slots[i] = std::move(slot);
+    }
+    m_stats.capacity = m_slots.size();
+    ++m_stats.resizes;
+  }
+
+private:
+  std::vector<Slot> m_slots;
+  double m_maxLoadFactor;
+  TranspositionTableStatistics m_stats;
+};
+
+// Fixed-size table for searches with bounded memory. Each hash has a single slot: new entry
+// replaces whatever was there. Only hashes are compared, so states with equal 64-bit hashes are
+// not told apart.
+template<typename T>
+class BoundedTranspositionTable {
+public:
+  // Capacity is the greatest power of two of slots, that fits into `bytes`
+  explicit BoundedTranspositionTable(size_t bytes)
+  {
+    size_t powerOfTwo = 1;
+    while (powerOfTwo * 2 * sizeof(Slot) <= bytes)
+    {
+      powerOfTwo *= 2;
+    }
+    m_slots.resize(powerOfTwo);
+    m_stats.capacity = powerOfTwo;
+  }
+
+  T *find(StateHash hash) noexcept
+  {
+    hash = normalize(hash);
+    Slot &slot = m_slots[static_cast<size_t>(hash) & (m_slots.size() - 1)];
+    ++m_stats.lookups;
+    ++m_stats.probes;
+    m_stats.maxProbeLength = 1;
+    if (slot.hash != hash)
+    {
+      return nullptr;
+    }
+    ++m_stats.hits;
+    return &slot.value;
+  }
+
+  void store(StateHash hash, const T &value) noexcept
+  {
+    hash = normalize(hash);
+    Slot &slot = m_slots[static_cast<size_t>(hash) & (m_slots.size() - 1)];
+    if (slot.hash == g_empty)
+    {
+      ++m_stats.size;
+    }
+    else if (slot.hash != hash)
+    {
+      ++m_stats.replacements;
+    }
+    slot.hash = hash;
+    slot.value = value;
+  }
+
+  size_t size() const noexcept { return m_stats.size; }
+  size_t memoryUsage() const noexcept { return m_slots.size() * sizeof(Slot); }
+  const TranspositionTableStatistics &statistics() const noexcept { return m_stats; }
+
+private:
+  static constexpr StateHash g_empty = 0;
+
+  struct Slot
+  {
+    StateHash hash = g_empty;
+    T value;
+  };
+
+  static StateHash normalize(StateHash hash) noexcept { return hash == g_empty ? 1 : hash; }
+
+private:
+  std::vector<Slot> m_slots;
+  TranspositionTableStatistics m_stats;
+};
+
+} // namespace soko
@@ -0,0 +1,33 @@
+#include "soko/tunnels.h"
+#include "soko/util.h"
+
+namespace soko
+{
+
+Tunnels::Tunnels(const MapStatic &m)
+  : m_cells(m.rows() * m.cols(), 0)
+{
+  for (size_t i = 0; i < m.rows(); ++i)
+  {
+    for (size_t j = 0; j < m.cols(); ++j)
+    {
+      const Pos p(i, j);
+      if (!m.isFree(p) || m.isDestination(p))
+      {
+        continue;
+      }
+      uint8_t &cell = m_cells[toCellIndex(p, m.cols())];
+      if (m.safeIsWall(p + Move::Up) && m.safeIsWall(p + Move::Down))
+      {
+        cell |= axisBit(Move::Left);
+      }
+      if (m.safeIsWall(p + Move::Left) && m.safeIsWall(p + Move::Right))
+      {
+        cell |= axisBit(Move::Up);
+      }
+      m_count += cell != 0;
+    }
+  }
+}
+
+} // namespace soko
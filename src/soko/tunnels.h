@@ -0,0 +1,35 @@
+#pragma once
+
+#include <vector>
+
+#include "soko/compact_state.h"
+#include "soko/move.h"
+
+namespace soko
+{
+
+// Static analysis of one cell wide corridors. A tunnel cell along an axis has walls on both
+// sides across it, so a box there can only be pushed along the axis, and nothing can pass it.
+// Destinations aren't tunnel cells: a box may have to stay on them.
+class Tunnels {
+public:
+  Tunnels() = default;
+  explicit Tunnels(const MapStatic &m);
+
+  // Box, pushed to the cell in direction `m`, can only be pushed further the same way
+  bool isTunnel(CellIndex c, Move m) const noexcept { return (m_cells[c] & axisBit(m)) != 0; }
+  bool empty() const noexcept { return m_count == 0; }
+
+private:
+  static constexpr uint8_t axisBit(Move m) noexcept
+  {
+    return m == Move::Left || m == Move::Right ? 1 : 2;
+  }
+
+private:
+  // bit 0: horizontal tunnel, bit 1: vertical tunnel
+  std::vector<uint8_t> m_cells;
+  size_t m_count = 0;
+};
+
+} // namespace soko
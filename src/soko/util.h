@@ -3,6 +3,8 @@
 #include "soko/map.h"
 #include "soko/move.h"
 
+#include <limits>
+
 namespace soko
 {
 constexpr size_t g_inf = std::numeric_limits<size_t>::max();
@@ -0,0 +1,29 @@
+#include "soko/zobrist.h"
+
+#include <random>
+
+namespace soko
+{
+
+ZobristKeys::ZobristKeys(size_t cells, uint64_t seed)
+  : m_keys(2 * cells)
+{
+  // fixed seed: hashes and therefore search order are reproducible
+  std::mt19937_64 generator(seed);
+  for (auto &key : m_keys)
+  {
+    key = generator();
+  }
+}
+
+StateHash ZobristKeys::hash(const CompactState &s) const noexcept
+{
+  StateHash result = unit(s.unit());
+  for (size_t i = 0; i < s.boxCount(); ++i)
+  {
+    result ^= box(s.boxes()[i]);
+  }
+  return result;
+}
+
+} // namespace soko
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "soko/compact_state.h"
+
+namespace soko
+{
+
+using StateHash = uint64_t;
+
+// Random keys for incremental hashing of search states.
+// State hash is xor of box keys of all box cells and unit key of the normalized unit cell,
+// so moving a single box or changing unit zone is an O(1) update.
+class ZobristKeys {
+public:
+  ZobristKeys() = default;
+  explicit ZobristKeys(size_t cells, uint64_t seed = 0x5eed5ebe11a5ULL);
+
+  StateHash box(CellIndex c) const noexcept
+  {
+    assert(2u * c < m_keys.size());
+    return m_keys[2u * c];
+  }
+  StateHash unit(CellIndex c) const noexcept
+  {
+    assert(2u * c + 1 < m_keys.size());
+    return m_keys[2u * c + 1];
+  }
+
+  StateHash hash(const CompactState &s) const noexcept;
+
+  StateHash moveBox(StateHash h, CellIndex from, CellIndex to) const noexcept
+  {
+    return h ^ box(from) ^ box(to);
+  }
+  StateHash moveUnit(StateHash h, CellIndex from, CellIndex to) const noexcept
+  {
+    return h ^ unit(from) ^ unit(to);
+  }
+
+private:
+  // box and unit keys of a cell are placed together
+  std::vector<StateHash> m_keys;
+};
+
+} // namespace soko
@@ -0,0 +1,76 @@
+#include <gtest/gtest.h>
+#include "soko/compact_state.h"
+
+namespace soko
+{
+
+namespace test
+{
+
+namespace
+{
+
+MapState createState(size_t nBoxes, size_t cols)
+{
+  MapState result;
+  for (size_t i = 0; i < nBoxes; ++i)
+  {
+    result.boxes.push_back({1 + i / (cols - 2), 1 + i % (cols - 2)});
+  }
+  result.unit = {0, 0};
+  return result;
+}
+
+} // namespace
+
+TEST(compactState, conversion)
+{
+  const size_t cols = 7;
+  MapState state = createState(20, cols);
+  CompactState compact(state, cols);
+  ASSERT_EQ(20, compact.boxCount());
+  MapState restored = compact.toMapState(cols);
+  EXPECT_EQ(state.boxes, restored.boxes);
+  EXPECT_EQ(state.unit, restored.unit);
+
+  CompactState copy = compact;
+  EXPECT_EQ(compact, copy);
+  copy.setUnit(toCellIndex({0, 1}, cols));
+  EXPECT_NE(compact, copy);
+}
+
+TEST(compactState, moveBox)
+{
+  const size_t cols = 10;
+  CompactState state(createState(5, cols), cols);
+  // boxes: 11 12 13 14 15
+  EXPECT_EQ(4, state.moveBox(0, 16));
+  EXPECT_EQ(0, state.moveBox(3, 1));
+  EXPECT_TRUE(std::is_sorted(state.boxes(), state.boxes() + state.boxCount()));
+  EXPECT_TRUE(state.isBox(1));
+  EXPECT_TRUE(state.isBox(16));
+  EXPECT_FALSE(state.isBox(11));
+  EXPECT_FALSE(state.isBox(15));
+}
+
+TEST(compactState, memoryPerNode)
+{
+  const size_t cols = 10;
+  const size_t nBoxes = 10;
+  MapState state = createState(nBoxes, cols);
+
+  // search node: parent link + state
+  size_t legacyNode = sizeof(void *) + sizeof(MapState) + nBoxes * sizeof(Pos);
+  size_t compactNode = sizeof(void *) + CompactState(state, cols).memoryUsage();
+  RecordProperty("legacyBytesPerNode", static_cast<int>(legacyNode));
+  RecordProperty("compactBytesPerNode", static_cast<int>(compactNode));
+  std::cout << "Memory per " << nBoxes << "-box node: " << legacyNode << " -> " << compactNode
+            << " bytes" << std::endl;
+
+  EXPECT_EQ(40, compactNode);
+  EXPECT_LT(compactNode * 5, legacyNode);
+}
+
+} // namespace test
+
+} // namespace soko
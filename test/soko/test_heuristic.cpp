@@ -1,5 +1,8 @@
 #include <gtest/gtest.h>
+#include <filesystem>
+#include <fstream>
 #include "soko/heuristic.h"
+#include "soko/pattern_database.h"
 #include "soko/util.h"
 
 namespace soko
@@ -44,6 +47,201 @@ TEST(heuristic, ZeroDistanceHungarianHeuristicTest)
   ASSERT_EQ(0, real);
 }
 
+TEST(heuristic, LowerBoundTest)
+{
+  // trimmed map:
+  // _ _ _ _ D
+  // _ B U B _
+  // D _ _ _ _
+  std::vector<std::vector<Cell>> rawM = {
+      {Cell::Wall, Cell::Wall, Cell::Wall, Cell::Wall, Cell::Wall, Cell::Wall, Cell::Wall},
+      {Cell::Wall, Cell::Field, Cell::Field, Cell::Field, Cell::Field, Cell::Destination, Cell::Wall},
+      {Cell::Wall, Cell::Field, Cell::Box, Cell::Unit, Cell::Box, Cell::Field, Cell::Wall},
+      {Cell::Wall, Cell::Destination, Cell::Field, Cell::Field, Cell::Field, Cell::Field, Cell::Wall},
+      {Cell::Wall, Cell::Wall, Cell::Wall, Cell::Wall, Cell::Wall, Cell::Wall, Cell::Wall}};
+  Map map(rawM);
+  std::unique_ptr<Heuristic> h = Heuristic::create(HeuristicType::HungarianTaxicab);
+  h->init(map);
+
+  MapState state = {{{1, 1}, {1, 3}}, {1, 2}};
+  EXPECT_EQ(4, (*h)(state));
+  EXPECT_EQ(4, h->lowerBound(state));
+
+  // both boxes are closest to the same destination
+  state.boxes = {{1, 3}, {1, 4}};
+  EXPECT_EQ(3, h->lowerBound(state));
+  EXPECT_EQ(5, (*h)(state));
+
+  // incremental evaluation from a cached parent
+  EXPECT_EQ(4, h->evaluate({{{1, 1}, {1, 3}}, {1, 2}}, 1));
+  EXPECT_EQ(5, h->evaluate(state, 2, {1, {1, 1}, {1, 4}}));
+  EXPECT_EQ(3, h->evaluate({{{0, 3}, {1, 1}}, {1, 2}}, 3, {1, {1, 3}, {0, 3}}));
+  EXPECT_EQ(g_unsolvable, h->evaluate({{{0, 3}, {0, 4}}, {1, 2}}, 4, {3, {1, 1}, {0, 4}}));
+
+  // bounds of successors by the duals of the parent
+  EXPECT_EQ(4, h->evaluate({{{1, 1}, {1, 3}}, {1, 2}}, 5));
+  EXPECT_EQ(3, h->lowerBound({{{1, 0}, {1, 3}}, {1, 2}}, {5, {1, 1}, {1, 0}}));
+  EXPECT_LE(h->lowerBound(state, {5, {1, 1}, {1, 4}}), 5);
+
+  // boxes on the top row can reach only one destination
+  state.boxes = {{0, 1}, {1, 4}};
+  EXPECT_EQ(g_unsolvable, (*h)(state));
+}
+
+TEST(heuristic, PatternDatabase)
+{
+  // trimmed map:
+  // D D _ _ _
+  // # # # _ _
+  // # # # _ U
+  const Cell W = Cell::Wall, F = Cell::Field, D = Cell::Destination;
+  std::vector<std::vector<Cell>> rawM = {{W, W, W, W, W, W, W},
+                                         {W, D, D, F, F, F, W},
+                                         {W, W, W, W, Cell::Box, F, W},
+                                         {W, W, W, W, Cell::Box, Cell::Unit, W},
+                                         {W, W, W, W, W, W, W}};
+  Map map(rawM);
+  auto hungarian = Heuristic::create(HeuristicType::HungarianTaxicab);
+  auto patterns = Heuristic::create(HeuristicType::HungarianPatternDatabase);
+  hungarian->init(map);
+  patterns->init(map);
+  EXPECT_TRUE(patterns->admissible());
+
+  // boxes don't hinder each other
+  MapState state = {{{0, 3}, {1, 3}}, {2, 4}};
+  EXPECT_EQ(6, (*hungarian)(state));
+  EXPECT_EQ(6, (*patterns)(state));
+
+  // the unit can't get between the boxes in the corridor
+  state.boxes = {{0, 1}, {0, 3}};
+  EXPECT_EQ(3, (*hungarian)(state));
+  EXPECT_EQ(g_unsolvable, (*patterns)(state));
+  EXPECT_EQ(g_unsolvable, patterns->evaluate(state, 1));
+  EXPECT_LE(patterns->lowerBound(state), 3);
+
+  // clone shares the tables
+  state.boxes = {{0, 2}, {1, 3}};
+  EXPECT_EQ(5, (*patterns)(state));
+  EXPECT_EQ(5, (*patterns->clone())(state));
+}
+
+TEST(heuristic, Penalties)
+{
+  // trimmed map, the box on destination (2, 0) blocks the box in the corridor:
+  // _ _ _ _ _
+  // _ # # # _
+  // * B _ D _
+  // _ # # # _
+  // _ _ U _ _
+  const Cell W = Cell::Wall, F = Cell::Field, D = Cell::Destination;
+  std::vector<std::vector<Cell>> corridorM = {{W, W, W, W, W, W, W},
+                                              {W, F, F, F, F, F, W},
+                                              {W, F, W, W, W, F, W},
+                                              {W, Cell::BoxDestination, Cell::Box, F, D, F, W},
+                                              {W, F, W, W, W, F, W},
+                                              {W, F, F, Cell::Unit, F, F, W},
+                                              {W, W, W, W, W, W, W}};
+  auto hungarian = Heuristic::create(HeuristicType::HungarianTaxicab);
+  auto penalties = Heuristic::create(HeuristicType::HungarianPenalties);
+  EXPECT_TRUE(penalties->admissible());
+  EXPECT_EQ(2, calculateHeuristic(hungarian.get(), Map(corridorM)));
+  // the blocking box leaves its destination and comes back
+  EXPECT_EQ(4, calculateHeuristic(penalties.get(), Map(corridorM)));
+  MapState state = {{{2, 0}, {2, 1}}, {4, 2}};
+  EXPECT_EQ(4, penalties->evaluate(state, 1));
+  EXPECT_EQ(4, penalties->clone()->evaluate(state, 1));
+  // the box leaves the corridor: no penalty
+  EXPECT_EQ(1, penalties->evaluate({{{2, 0}, {2, 2}}, {4, 2}}, 2, {1, {2, 1}, {2, 2}}));
+  // boxes along the wall freeze each other off destinations
+  EXPECT_EQ(g_unsolvable, penalties->evaluate({{{0, 1}, {0, 2}}, {4, 2}}, 3));
+
+  // trimmed map, the box on destination (0, 0) is frozen in the corner, and the other box can
+  // reach (0, 2) only with the unit on (0, 0):
+  // * _ D
+  // _ B _
+  // U _ #
+  std::vector<std::vector<Cell>> frozenM = {{W, W, W, W, W},
+                                            {W, Cell::BoxDestination, F, D, W},
+                                            {W, F, Cell::Box, F, W},
+                                            {W, Cell::Unit, F, W, W},
+                                            {W, W, W, W, W}};
+  EXPECT_EQ(2, calculateHeuristic(hungarian.get(), Map(frozenM)));
+  EXPECT_EQ(g_unsolvable, calculateHeuristic(penalties.get(), Map(frozenM)));
+  // frozen boxes on destinations are solved
+  EXPECT_EQ(0, penalties->evaluate({{{0, 0}, {0, 2}}, {2, 0}}, 4));
+}
+
+TEST(heuristic, PushDistances)
+{
+  // trimmed map, the box is pushed right, but the unit can't walk round it to push it down:
+  // # # _
+  // U B _
+  // # # D
+  const Cell W = Cell::Wall, F = Cell::Field;
+  std::vector<std::vector<Cell>> rawM = {{W, W, W, W, W},
+                                         {W, W, W, F, W},
+                                         {W, Cell::Unit, Cell::Box, F, W},
+                                         {W, W, W, Cell::Destination, W},
+                                         {W, W, W, W, W}};
+  auto hungarian = Heuristic::create(HeuristicType::HungarianTaxicab);
+  auto push = Heuristic::create(HeuristicType::HungarianTaxicabPush);
+  EXPECT_TRUE(push->admissible());
+  EXPECT_EQ(2, calculateHeuristic(hungarian.get(), Map(rawM)));
+  EXPECT_EQ(g_unsolvable, calculateHeuristic(push.get(), Map(rawM)));
+  // the unit is above the box: a single push
+  EXPECT_EQ(1, (*push)({{{1, 2}}, {0, 2}}));
+  EXPECT_LT(0, push->bytes());
+}
+
+TEST(heuristic, PatternDatabaseCache)
+{
+  // trimmed map:
+  // _ _ _ _ D
+  // _ B U B _
+  // D _ _ _ _
+  std::vector<std::vector<Cell>> rawM = {
+      {Cell::Wall, Cell::Wall, Cell::Wall, Cell::Wall, Cell::Wall, Cell::Wall, Cell::Wall},
+      {Cell::Wall, Cell::Field, Cell::Field, Cell::Field, Cell::Field, Cell::Destination, Cell::Wall},
+      {Cell::Wall, Cell::Field, Cell::Box, Cell::Unit, Cell::Box, Cell::Field, Cell::Wall},
+      {Cell::Wall, Cell::Destination, Cell::Field, Cell::Field, Cell::Field, Cell::Field, Cell::Wall},
+      {Cell::Wall, Cell::Wall, Cell::Wall, Cell::Wall, Cell::Wall, Cell::Wall, Cell::Wall}};
+  const MapStatic map = mapToMapStatic(Map(rawM));
+  const std::filesystem::path directory =
+      std::filesystem::temp_directory_path() / "soko-test-pattern-database";
+  std::filesystem::remove_all(directory);
+  std::filesystem::create_directories(directory);
+  const std::vector<std::vector<Pos>> placements = {
+      {{1, 1}, {1, 3}}, {{0, 4}, {2, 0}}, {{0, 0}, {1, 1}}, {{1, 2}, {2, 4}}};
+
+  PatternDatabase built(map, 2, directory.string());
+  EXPECT_FALSE(built.loadedFromCache());
+  EXPECT_EQ(1, built.groups());
+  EXPECT_EQ(4, built.evaluate(placements[0]));
+  EXPECT_EQ(0, built.evaluate(placements[1]));
+  // corner box can't be moved
+  EXPECT_EQ(g_unsolvable, built.evaluate(placements[2]));
+
+  PatternDatabase loaded(map, 2, directory.string());
+  EXPECT_TRUE(loaded.loadedFromCache());
+  for (auto &boxes : placements)
+  {
+    EXPECT_EQ(built.evaluate(boxes), loaded.evaluate(boxes));
+  }
+
+  // another group size is another layout
+  EXPECT_FALSE(PatternDatabase(map, 1, directory.string()).loadedFromCache());
+
+  // damaged file is built again
+  for (auto &file : std::filesystem::directory_iterator(directory))
+  {
+    std::filesystem::resize_file(file.path(), std::filesystem::file_size(file.path()) / 2);
+  }
+  PatternDatabase rebuilt(map, 2, directory.string());
+  EXPECT_FALSE(rebuilt.loadedFromCache());
+  EXPECT_EQ(built.evaluate(placements[3]), rebuilt.evaluate(placements[3]));
+  std::filesystem::remove_all(directory);
+}
+
 } // namespace test
 
 } // namespace soko
@@ -1,5 +1,7 @@
 #include <gtest/gtest.h>
+#include <random>
 #include "soko/hungarian_algo.h"
+#include "soko/util.h"
 
 namespace soko
 {
@@ -110,6 +112,60 @@ TEST(hungarian, HungarianAlgo_test)
   EXPECT_EQ(std::vector<size_t>({1, 0}), result);
 }
 
+TEST(hungarian, IncrementalAssignment_test)
+{
+  IncrementalAssignment algo;
+  algo.solve(Mat<size_t>({{32, 28, 4, 26, 4},
+                          {17, 19, 4, 17, 4},
+                          {4, 4, 5, 4, 4},
+                          {17, 14, 4, 14, 4},
+                          {21, 16, 4, 13, 4}}));
+  EXPECT_EQ(std::vector<size_t>({2, 4, 0, 1, 3}), algo.assignment());
+  EXPECT_EQ(4 + 4 + 4 + 14 + 13, algo.cost());
+
+  // the only allowed assignment
+  algo.solve(Mat<size_t>({{1, g_inf}, {2, 7}}));
+  EXPECT_EQ(8, algo.cost());
+  algo.solve(Mat<size_t>({{1, g_inf}, {2, g_inf}}));
+  EXPECT_EQ(g_inf, algo.cost());
+}
+
+TEST(hungarian, IncrementalAssignmentRepair_test)
+{
+  const size_t n = 8;
+  std::mt19937 random(42);
+  std::uniform_int_distribution<size_t> cost(0, 20);
+  auto randomCost = [&]() {
+    size_t c = cost(random);
+    return c == 0 ? g_inf : c;
+  };
+
+  Mat<size_t> costs(n, n);
+  for (auto &c : costs)
+  {
+    c = randomCost();
+  }
+  IncrementalAssignment incremental;
+  incremental.solve(costs);
+  for (size_t step = 0; step < 200; ++step)
+  {
+    size_t row = step % n;
+    for (size_t j = 0; j < n; ++j)
+    {
+      costs.at(row, j) = randomCost();
+    }
+    auto duals = incremental.duals();
+    const size_t bound = IncrementalAssignment::repairBound(
+        duals, row, std::vector<size_t>(costs.begin() + row * n, costs.begin() + (row + 1) * n));
+    incremental.repair(costs, duals, row);
+    EXPECT_LE(bound, incremental.cost()) << step;
+
+    IncrementalAssignment full;
+    full.solve(costs);
+    ASSERT_EQ(full.cost(), incremental.cost()) << step;
+  }
+}
+
 } // namespace test
 
 } // namespace soko
@@ -0,0 +1,52 @@
+#include <gtest/gtest.h>
+#include "soko/node_arena.h"
+
+namespace soko
+{
+
+namespace test
+{
+
+TEST(nodeArena, allocate)
+{
+  // tiny slabs: 4 records of 3 cells each
+  NodeArena arena(4 * 24);
+  arena.reset(3);
+  ASSERT_EQ(24, arena.recordBytes());
+  EXPECT_EQ(16, sizeof(NodeHeader));
+
+  const size_t n = 100;
+  for (CellIndex i = 0; i < n; ++i)
+  {
+    CellIndex cells[3] = {i, static_cast<CellIndex>(i + 1), 0};
+    NodeId parent = i == 0 ? g_noNode : i - 1;
+    ASSERT_EQ(i, arena.allocate(parent, i * 7, cells, i));
+  }
+  EXPECT_EQ(n, arena.size());
+  EXPECT_EQ(n * 24, arena.bytesUsed());
+  EXPECT_EQ(n / 4 * 4 * 24, arena.bytesReserved());
+
+  for (CellIndex i = 0; i < n; ++i)
+  {
+    EXPECT_EQ(i * 7, arena.header(i).hash);
+    EXPECT_EQ(i == 0 ? g_noNode : i - 1, arena.header(i).parent);
+    EXPECT_EQ(i, arena.header(i).g);
+    EXPECT_EQ(i, arena.cells(i)[0]);
+    EXPECT_EQ(i + 1, arena.state(i).boxes()[1]);
+  }
+
+  // slabs are reused after reset
+  arena.reset(3);
+  EXPECT_EQ(0, arena.size());
+  EXPECT_EQ(n / 4 * 4 * 24, arena.bytesReserved());
+  CellIndex cells[3] = {5, 6, 7};
+  EXPECT_EQ(0, arena.allocate(g_noNode, 0, cells));
+  EXPECT_EQ(7, arena.state(0).unit());
+
+  arena.release();
+  EXPECT_EQ(0, arena.bytesReserved());
+}
+
+} // namespace test
+
+} // namespace soko
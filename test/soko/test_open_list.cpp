@@ -0,0 +1,72 @@
+#include <gtest/gtest.h>
+#include "soko/open_list.h"
+
+namespace soko
+{
+
+namespace test
+{
+
+TEST(openList, bucketQueueOrder)
+{
+  BucketQueue q;
+  q.push(1, 3, 2); // f = 5
+  q.push(2, 1, 3); // f = 4
+  q.push(3, 2, 2); // f = 4, lower h
+  q.push(4, 0, 7); // f = 7
+  ASSERT_EQ(4, q.size());
+
+  auto e = q.pop();
+  EXPECT_EQ(3, e.node);
+  EXPECT_EQ(2, e.g);
+  EXPECT_EQ(2, e.h);
+  EXPECT_EQ(2, q.pop().node);
+
+  // f below the current minimum
+  q.push(5, 1, 1);
+  EXPECT_EQ(5, q.pop().node);
+  EXPECT_EQ(1, q.pop().node);
+  EXPECT_EQ(4, q.pop().node);
+  EXPECT_TRUE(q.empty());
+
+  q.push(6, 10, 0);
+  EXPECT_EQ(6, q.pop().node);
+  EXPECT_TRUE(q.empty());
+}
+
+TEST(openList, binaryHeapTieBreak)
+{
+  BinaryHeapQueue q;
+  q.push(1, 1, 4);
+  q.push(2, 4, 1);
+  q.push(3, 2, 3);
+  EXPECT_EQ(2, q.pop().node);
+  EXPECT_EQ(3, q.pop().node);
+  EXPECT_EQ(1, q.pop().node);
+}
+
+TEST(openList, sameOrderByF)
+{
+  BucketQueue bucket;
+  BinaryHeapQueue heap;
+  for (NodeId i = 0; i < 100; ++i)
+  {
+    size_t g = (i * 7) % 13;
+    size_t h = (i * 5) % 11;
+    bucket.push(i, g, h);
+    heap.push(i, g, h);
+  }
+  while (!bucket.empty())
+  {
+    ASSERT_FALSE(heap.empty());
+    auto fromHeap = heap.pop();
+    auto fromBucket = bucket.pop();
+    EXPECT_EQ(fromHeap.f(), fromBucket.f());
+    EXPECT_EQ(fromHeap.h, fromBucket.h);
+  }
+  EXPECT_TRUE(heap.empty());
+}
+
+} // namespace test
+
+} // namespace soko
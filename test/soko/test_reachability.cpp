@@ -0,0 +1,185 @@
+#include <gtest/gtest.h>
+#include "soko/bitboard_reachability.h"
+#include "soko/reachability.h"
+#include "soko/util.h"
+
+namespace soko
+{
+
+namespace test
+{
+
+namespace
+{
+
+// Reachability must agree with drawUnitMap and pick its first reachable cell
+template<typename R>
+void checkFill(R &r, const Map &map, Pos unit, const std::vector<Pos> &boxes)
+{
+  std::vector<CellIndex> cells;
+  for (auto box : boxes)
+  {
+    cells.push_back(toCellIndex(box, map.cols()));
+  }
+  std::sort(cells.begin(), cells.end());
+  r.setBoxes(cells.data(), cells.size());
+  CellIndex normalized = r.fill(toCellIndex(unit, map.cols()));
+
+  Mat<bool> expected = drawUnitMap(map, unit, boxes);
+  CellIndex expectedNormalized = g_noCell;
+  for (size_t i = 0; i < map.rows(); ++i)
+  {
+    for (size_t j = 0; j < map.cols(); ++j)
+    {
+      CellIndex c = toCellIndex({i, j}, map.cols());
+      EXPECT_EQ(expected.at(i, j), r.isReachable(c)) << i << ", " << j;
+      if (expected.at(i, j) && expectedNormalized == g_noCell)
+      {
+        expectedNormalized = c;
+      }
+    }
+  }
+  EXPECT_EQ(expectedNormalized, normalized);
+}
+
+} // namespace
+
+TEST(reachability, matchesUnitMap)
+{
+  std::vector<std::vector<Cell>> rawM = {
+      {Cell::Field, Cell::Field, Cell::Wall, Cell::Field, Cell::Field},
+      {Cell::Field, Cell::Box, Cell::Field, Cell::Box, Cell::Field},
+      {Cell::Wall, Cell::Field, Cell::Box, Cell::Field, Cell::Wall},
+      {Cell::Field, Cell::Field, Cell::Field, Cell::Unit, Cell::Field}};
+  Map map(rawM);
+  std::vector<Pos> boxes;
+  Pos unit;
+  MapStatic m = mapToMapStatic(map, &boxes, &unit);
+
+  Reachability r(m);
+  EXPECT_EQ(20, r.cells());
+  checkFill(r, m, unit, boxes);
+  checkFill(r, m, {0, 0}, boxes);
+  checkFill(r, m, {0, 3}, boxes);
+  checkFill(r, m, {0, 3}, {{1, 1}, {1, 3}, {2, 1}});
+
+  for (bool avx2 : {false, true})
+  {
+    BitboardReachability b(m);
+    b.setAvx2(avx2);
+    checkFill(b, m, unit, boxes);
+    checkFill(b, m, {0, 0}, boxes);
+    checkFill(b, m, {0, 3}, boxes);
+    checkFill(b, m, {0, 3}, {{1, 1}, {1, 3}, {2, 1}});
+  }
+}
+
+TEST(reachability, walkDistances)
+{
+  std::vector<std::vector<Cell>> rawM = {
+      {Cell::Field, Cell::Field, Cell::Wall, Cell::Field, Cell::Field},
+      {Cell::Field, Cell::Box, Cell::Field, Cell::Box, Cell::Field},
+      {Cell::Wall, Cell::Field, Cell::Box, Cell::Field, Cell::Wall},
+      {Cell::Field, Cell::Field, Cell::Field, Cell::Unit, Cell::Field}};
+  Map map(rawM);
+  std::vector<Pos> boxes;
+  Pos unit;
+  MapStatic m = mapToMapStatic(map, &boxes, &unit);
+  std::vector<CellIndex> cells;
+  for (auto box : boxes)
+  {
+    cells.push_back(toCellIndex(box, m.cols()));
+  }
+  std::sort(cells.begin(), cells.end());
+
+  Reachability r(m);
+  r.setBoxes(cells.data(), cells.size());
+  EXPECT_EQ(toCellIndex({2, 1}, m.cols()), r.walk(toCellIndex(unit, m.cols())));
+  const std::vector<std::pair<Pos, uint32_t>> expected = {
+      {{3, 3}, 0}, {{3, 2}, 1}, {{3, 4}, 1}, {{2, 3}, 1}, {{3, 1}, 2}, {{3, 0}, 3}, {{2, 1}, 3}};
+  size_t reachable = 0;
+  for (CellIndex c = 0; c < r.cells(); ++c)
+  {
+    reachable += r.isReachable(c);
+  }
+  EXPECT_EQ(expected.size(), reachable);
+  for (auto &cell : expected)
+  {
+    CellIndex c = toCellIndex(cell.first, m.cols());
+    ASSERT_TRUE(r.isReachable(c));
+    EXPECT_EQ(cell.second, r.distance(c));
+  }
+}
+
+TEST(reachability, bitboardLargeMap)
+{
+  // 64 columns, winding corridor through 9 rows: area has to pass through every row and
+  // every row's width
+  const size_t rows = 9;
+  const size_t cols = BitboardReachability::g_maxCols;
+  std::vector<std::vector<Cell>> rawM(rows, std::vector<Cell>(cols, Cell::Field));
+  for (size_t i = 1; i < rows; i += 2)
+  {
+    for (size_t j = 0; j < cols; ++j)
+    {
+      rawM[i][j] = Cell::Wall;
+    }
+    rawM[i][i % 4 == 1 ? cols - 1 : 0] = Cell::Field;
+  }
+  rawM[rows - 1][0] = Cell::Unit;
+  rawM[4][10] = Cell::Box;
+  rawM[4][20] = Cell::Box;
+  Map map(rawM);
+  std::vector<Pos> boxes;
+  Pos unit;
+  MapStatic m = mapToMapStatic(map, &boxes, &unit);
+
+  for (bool avx2 : {false, true})
+  {
+    BitboardReachability b(m);
+    b.setAvx2(avx2);
+    checkFill(b, m, unit, boxes);
+    checkFill(b, m, {4, 15}, boxes);
+    checkFill(b, m, {0, 0}, {});
+  }
+
+  std::vector<std::vector<Cell>> wide = {std::vector<Cell>(cols + 1, Cell::Field)};
+  wide[0][0] = Cell::Unit;
+  EXPECT_FALSE(BitboardReachability::supports(mapToMapStatic(Map(wide))));
+  EXPECT_THROW(BitboardReachability{mapToMapStatic(Map(wide))}, std::logic_error);
+}
+
+TEST(reachability, moveBox)
+{
+  std::vector<std::vector<Cell>> rawM = {{Cell::Unit, Cell::Field, Cell::Box, Cell::Field}};
+  Map map(rawM);
+  MapStatic m = mapToMapStatic(map);
+  Reachability r(m);
+  CellIndex box = 2;
+  r.setBoxes(&box, 1);
+  EXPECT_EQ(g_noCell, r.neighbour(0, Move::Left));
+  EXPECT_EQ(1, r.neighbour(0, Move::Right));
+
+  r.fill(0);
+  EXPECT_TRUE(r.isReachable(1));
+  EXPECT_FALSE(r.isReachable(3));
+
+  r.moveBox(2, 3);
+  EXPECT_EQ(0, r.fill(2));
+  EXPECT_TRUE(r.isReachable(2));
+  EXPECT_FALSE(r.isReachable(3));
+
+  BitboardReachability b(m);
+  box = 2;
+  b.setBoxes(&box, 1);
+  EXPECT_EQ(0, b.fill(0));
+  EXPECT_FALSE(b.isReachable(3));
+  b.moveBox(2, 3);
+  EXPECT_EQ(0, b.fill(0));
+  EXPECT_TRUE(b.isReachable(2));
+  EXPECT_FALSE(b.isReachable(3));
+}
+
+} // namespace test
+
+} // namespace soko
@@ -1,4 +1,10 @@
 #include <gtest/gtest.h>
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <memory>
+#include <queue>
+#include "interface/util.h"
 #include "soko/solver.h"
 #include "soko/util.h"
 
@@ -8,6 +14,166 @@ namespace soko
 namespace test
 {
 
+namespace
+{
+
+// Minimal moves of the level: breadth-first search over unit moves and exact box positions
+size_t minimalMoves(const Map &level)
+{
+  MapState start;
+  MapStatic m = mapToMapStatic(level, &start.boxes, &start.unit);
+  using State = std::pair<Pos, std::vector<Pos>>;
+  std::map<State, size_t> moves = {{{start.unit, start.boxes}, 0}};
+  std::queue<State> states;
+  states.push({start.unit, start.boxes});
+  while (!states.empty())
+  {
+    const State state = states.front();
+    states.pop();
+    const size_t distance = moves[state];
+    if (std::all_of(state.second.begin(), state.second.end(),
+                    [&m](Pos box) { return m.isDestination(box); }))
+    {
+      return distance;
+    }
+    for (auto move : {Move::Left, Move::Up, Move::Right, Move::Down})
+    {
+      State next = state;
+      next.first = state.first + move;
+      if (!m.safeIsFree(next.first))
+      {
+        continue;
+      }
+      auto box = std::find(next.second.begin(), next.second.end(), next.first);
+      if (box != next.second.end())
+      {
+        *box = next.first + move;
+        if (!m.safeIsFree(*box) ||
+            std::count(next.second.begin(), next.second.end(), *box) != 1)
+        {
+          continue;
+        }
+        std::sort(next.second.begin(), next.second.end());
+      }
+      if (moves.emplace(next, distance + 1).second)
+      {
+        states.push(next);
+      }
+    }
+  }
+  return g_inf;
+}
+
+// Plays the moves on the map. Returns false if some move is impossible
+bool applyMoves(Map &map, const std::vector<Move> &moves)
+{
+  for (Move m : moves)
+  {
+    Pos unit = getUnit(map);
+    Pos next = unit + m;
+    if (map.isBox(next))
+    {
+      if (!map.isFree(next + m))
+      {
+        return false;
+      }
+      map.at(next + m) = placeItem(map.at(next + m), Cell::Box);
+      map.at(next) = removeItem(map.at(next), Cell::Box);
+    }
+    if (!map.isFree(next))
+    {
+      return false;
+    }
+    map.at(unit) = removeItem(map.at(unit), Cell::Unit);
+    map.at(next) = placeItem(map.at(next), Cell::Unit);
+  }
+  return true;
+}
+
+// Level of levels/levels.txt
+Map bundledLevel(const std::string &name)
+{
+  std::ifstream file(std::string(SOKO_LEVELS_DIR) + "/levels.txt");
+  for (auto &level : parseFromFile(file))
+  {
+    if (level.first == name)
+    {
+      return level.second;
+    }
+  }
+  throw std::runtime_error("Level " + name + " isn't bundled");
+}
+
+// Pushes of the plain A* solution
+size_t aStarPushes(const Map &level)
+{
+  Solver s;
+  s.setHeuristic(Heuristic::create(HeuristicType::HungarianTaxicab));
+  s.solve(level);
+  return s.solved() == SolveState::Solved ? s.boxMovements() : g_inf;
+}
+
+// Two boxes go to the opposite destinations: 4 pushes at least
+Map twoBoxLevel()
+{
+  std::vector<std::vector<Cell>> rawM = {
+      {Cell::Wall, Cell::Wall, Cell::Wall, Cell::Wall, Cell::Wall, Cell::Wall, Cell::Wall},
+      {Cell::Wall, Cell::Field, Cell::Field, Cell::Field, Cell::Field, Cell::Destination, Cell::Wall},
+      {Cell::Wall, Cell::Field, Cell::Box, Cell::Unit, Cell::Box, Cell::Field, Cell::Wall},
+      {Cell::Wall, Cell::Destination, Cell::Field, Cell::Field, Cell::Field, Cell::Field, Cell::Wall},
+      {Cell::Wall, Cell::Wall, Cell::Wall, Cell::Wall, Cell::Wall, Cell::Wall, Cell::Wall}};
+  return Map(rawM);
+}
+
+// Solver, which has solved twoBoxLevel with the config
+std::unique_ptr<Solver> solveWith(const SolverConfig &config,
+                                  HeuristicType type = HeuristicType::HungarianTaxicab)
+{
+  auto s = std::make_unique<Solver>();
+  s->setHeuristic(Heuristic::create(type));
+  s->setConfig(config);
+  s->solve(twoBoxLevel());
+  return s;
+}
+
+// Solution of twoBoxLevel with the minimal pushes
+testing::AssertionResult solvedWithMinimalPushes(const Solver &s)
+{
+  if (s.solved() != SolveState::Solved)
+  {
+    return testing::AssertionFailure() << "level isn't solved";
+  }
+  if (s.boxMovements() != 4)
+  {
+    return testing::AssertionFailure() << s.boxMovements() << " pushes instead of 4";
+  }
+  return testing::AssertionSuccess();
+}
+
+// Moves, which put all boxes of the level on destinations
+bool solves(Map level, const std::vector<Move> &moves)
+{
+  if (!applyMoves(level, moves))
+  {
+    return false;
+  }
+  for (size_t i = 0; i < level.rows(); ++i)
+  {
+    for (size_t j = 0; j < level.cols(); ++j)
+    {
+      if (level.at(i, j) == Cell::Box)
+      {
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+bool solvesTwoBoxLevel(const std::vector<Move> &moves) { return solves(twoBoxLevel(), moves); }
+
+} // namespace
+
 TEST(solver, simpleSolverTest)
 {
   std::vector<std::vector<Cell>> rawM = {{Cell::Wall, Cell::Field, Cell::Field},
@@ -22,6 +188,463 @@ TEST(solver, simpleSolverTest)
   auto result = s.result();
   ASSERT_TRUE(s.solved() == SolveState::Solved);
   ASSERT_EQ(std::vector<Move>({Move::Right, Move::Up, Move::Right, Move::Down}), result);
+
+  auto &closedSet = s.statistics().closedSet;
+  EXPECT_LT(0, closedSet.size);
+  EXPECT_LE(closedSet.loadFactor(), 0.75);
+  EXPECT_LE(1, closedSet.averageProbeLength());
+  EXPECT_EQ(closedSet.size, s.statistics().nodes);
+  EXPECT_LT(0, s.statistics().arenaBytes);
+}
+
+TEST(solver, binaryHeapOpenList)
+{
+  std::vector<std::vector<Cell>> rawM = {{Cell::Wall, Cell::Field, Cell::Field},
+                                         {Cell::Unit, Cell::Box, Cell::Field},
+                                         {Cell::Wall, Cell::Field, Cell::Destination}};
+
+  Solver s;
+  s.setHeuristic(Heuristic::create(HeuristicType::HungarianTaxicab));
+  SolverConfig config;
+  config.openList = OpenListType::BinaryHeap;
+  s.setConfig(config);
+  s.solve(Map(rawM));
+  ASSERT_TRUE(s.solved() == SolveState::Solved);
+  EXPECT_EQ(2, s.boxMovements());
+}
+
+TEST(solver, reopenNodes)
+{
+  size_t pushes[2];
+  for (bool reopen : {false, true})
+  {
+    SolverConfig config;
+    config.reopenNodes = reopen;
+    auto s = solveWith(config);
+    ASSERT_TRUE(s->solved() == SolveState::Solved);
+    pushes[reopen] = s->boxMovements();
+
+    auto &stats = s->statistics();
+    EXPECT_LT(0, stats.expanded);
+    EXPECT_LE(stats.expanded, stats.nodes + stats.reopened);
+    EXPECT_LE(stats.nodes - 1, stats.generated);
+    if (!reopen)
+    {
+      EXPECT_EQ(0, stats.reopened);
+    }
+  }
+  // admissible heuristic with reopening gives the minimal number of pushes
+  EXPECT_EQ(4, pushes[true]);
+  EXPECT_LE(pushes[true], pushes[false]);
+}
+
+TEST(solver, idaStar)
+{
+  SolverConfig config;
+  config.algorithm = SearchAlgorithm::IdaStar;
+  // table of a single slot still gives optimal solution, only slower
+  for (size_t tableBytes : {size_t(1) << 20, size_t(0)})
+  {
+    config.tableBytes = tableBytes;
+    auto s = solveWith(config);
+    ASSERT_TRUE(solvedWithMinimalPushes(*s));
+
+    auto &stats = s->statistics();
+    EXPECT_LE(1, stats.iterations);
+    EXPECT_LT(0, stats.expanded);
+    EXPECT_LE(stats.closedSet.size, stats.closedSet.capacity);
+  }
+
+  // node limit
+  config.maxNodes = 1;
+  auto s = solveWith(config);
+  EXPECT_TRUE(s->solved() == SolveState::NotSolved);
+  EXPECT_EQ(1, s->statistics().expanded);
+}
+
+TEST(solver, lazyHeuristic)
+{
+  SolverStatistics stats[2];
+  for (bool lazy : {false, true})
+  {
+    SolverConfig config;
+    config.lazyHeuristic = lazy;
+    auto s = solveWith(config);
+    ASSERT_TRUE(solvedWithMinimalPushes(*s));
+    stats[lazy] = s->statistics();
+  }
+  // lazy mode calculates heuristic only for popped nodes
+  EXPECT_LT(stats[true].heuristicCalls, stats[false].heuristicCalls);
+}
+
+TEST(solver, partialExpansion)
+{
+  const size_t optimalMoves = minimalMoves(twoBoxLevel());
+
+  for (auto optimality : {Optimality::None, Optimality::Pushes, Optimality::Moves})
+  {
+    SolverStatistics stats[2];
+    for (bool partial : {false, true})
+    {
+      SolverConfig config;
+      config.optimality = optimality;
+      config.partialExpansion = partial;
+      auto s = solveWith(config);
+      ASSERT_TRUE(solvedWithMinimalPushes(*s));
+      if (optimality == Optimality::Moves)
+      {
+        EXPECT_EQ(optimalMoves, s->result().size());
+      }
+      stats[partial] = s->statistics();
+    }
+    // successors, which lead away from the destinations, are never stored
+    EXPECT_EQ(0, stats[false].deferred);
+    EXPECT_LT(0, stats[true].deferred);
+    EXPECT_LT(stats[true].nodes, stats[false].nodes);
+    EXPECT_LT(stats[true].heuristicCalls, stats[false].heuristicCalls);
+  }
+}
+
+TEST(solver, batchedEvaluation)
+{
+  auto serial = solveWith(SolverConfig());
+  ASSERT_TRUE(serial->solved() == SolveState::Solved);
+
+  for (size_t threads : {1, 2, 4})
+  {
+    for (size_t batchNodes : {1, 3})
+    {
+      SolverConfig config;
+      config.evaluationThreads = threads;
+      config.batchNodes = batchNodes;
+      auto s = solveWith(config);
+      ASSERT_TRUE(solvedWithMinimalPushes(*s));
+      if (batchNodes == 1)
+      {
+        // same open list order as the serial search
+        EXPECT_EQ(serial->result(), s->result());
+        EXPECT_EQ(serial->statistics().expanded, s->statistics().expanded);
+        EXPECT_EQ(serial->statistics().nodes, s->statistics().nodes);
+      }
+    }
+  }
+}
+
+TEST(solver, bidirectional)
+{
+  SolverConfig config;
+  config.algorithm = SearchAlgorithm::Bidirectional;
+  auto s = solveWith(config);
+  ASSERT_TRUE(solvedWithMinimalPushes(*s));
+  EXPECT_LT(0, s->statistics().backwardNodes);
+  EXPECT_LT(s->statistics().backwardNodes, s->statistics().nodes);
+
+  // joined path is a valid sequence of moves
+  EXPECT_TRUE(solvesTwoBoxLevel(s->result()));
+}
+
+TEST(solver, bidirectionalLevel)
+{
+  // the searches meet far from both ends of the solution
+  const Map level = bundledLevel("level2");
+  Solver s;
+  s.setHeuristic(Heuristic::create(HeuristicType::HungarianTaxicab));
+  SolverConfig config;
+  config.algorithm = SearchAlgorithm::Bidirectional;
+  s.setConfig(config);
+  s.solve(level);
+  ASSERT_TRUE(s.solved() == SolveState::Solved);
+  EXPECT_LE(aStarPushes(level), s.boxMovements());
+  EXPECT_LT(s.statistics().nodes / 4, s.statistics().backwardNodes);
+  EXPECT_TRUE(solves(level, s.result()));
+
+  // the box is pushed right, but the unit can't walk round it to push it down
+  const Cell W = Cell::Wall, F = Cell::Field;
+  std::vector<std::vector<Cell>> unsolvableM = {{W, W, W, W, W},
+                                                {W, W, W, F, W},
+                                                {W, Cell::Unit, Cell::Box, F, W},
+                                                {W, W, W, Cell::Destination, W},
+                                                {W, W, W, W, W}};
+  s.solve(Map(unsolvableM));
+  EXPECT_TRUE(s.solved() == SolveState::NotSolved);
+  EXPECT_LT(0, s.statistics().backwardNodes);
+}
+
+TEST(solver, hdaStar)
+{
+  SolverConfig config;
+  config.algorithm = SearchAlgorithm::HdaStar;
+  for (size_t threads : {1, 2, 4})
+  {
+    config.threads = threads;
+    auto s = solveWith(config);
+    ASSERT_TRUE(solvedWithMinimalPushes(*s));
+
+    auto &stats = s->statistics();
+    EXPECT_LT(0, stats.expanded);
+    EXPECT_EQ(stats.nodes, stats.closedSet.size);
+    if (threads == 1)
+    {
+      EXPECT_EQ(0, stats.messages);
+    }
+  }
+
+  // node limit
+  config.threads = 2;
+  config.maxNodes = 1;
+  EXPECT_TRUE(solveWith(config)->solved() == SolveState::NotSolved);
+}
+
+TEST(solver, hdaStarLevel)
+{
+  // several boxes: successors cross the threads all the time
+  const Map level = bundledLevel("level2");
+  const size_t pushes = aStarPushes(level);
+  ASSERT_NE(g_inf, pushes);
+  for (size_t threads : {2, 4, 8})
+  {
+    Solver s;
+    s.setHeuristic(Heuristic::create(HeuristicType::HungarianTaxicab));
+    SolverConfig config;
+    config.algorithm = SearchAlgorithm::HdaStar;
+    config.threads = threads;
+    s.setConfig(config);
+    s.solve(level);
+    ASSERT_TRUE(s.solved() == SolveState::Solved);
+    EXPECT_EQ(pushes, s.boxMovements());
+    EXPECT_LT(0, s.statistics().messages);
+
+    // path is joined from the nodes of several threads
+    EXPECT_TRUE(solves(level, s.result()));
+  }
+}
+
+TEST(solver, araStar)
+{
+  Solver s;
+  s.setHeuristic(Heuristic::create(HeuristicType::HungarianTaxicab));
+  SolverConfig config;
+  config.algorithm = SearchAlgorithm::AraStar;
+  config.weight = 3;
+  config.weightStep = 1;
+  s.setConfig(config);
+  std::vector<double> bounds;
+  std::vector<size_t> pushes;
+  s.setSolutionCallback([&](const std::vector<Move> &moves, double bound) {
+    EXPECT_EQ(moves, s.result());
+    bounds.push_back(bound);
+    pushes.push_back(s.boxMovements());
+  });
+  s.solve(twoBoxLevel());
+  ASSERT_TRUE(solvedWithMinimalPushes(s));
+  ASSERT_FALSE(bounds.empty());
+  EXPECT_EQ(bounds.size(), s.statistics().solutions);
+  EXPECT_DOUBLE_EQ(1., s.statistics().suboptimality);
+  for (size_t i = 1; i < bounds.size(); ++i)
+  {
+    EXPECT_LE(bounds[i], bounds[i - 1]);
+    EXPECT_LT(pushes[i], pushes[i - 1]);
+  }
+
+  // weighted A*: the first solution only
+  config.weightStep = 0;
+  s.setConfig(config);
+  bounds.clear();
+  s.solve(twoBoxLevel());
+  ASSERT_TRUE(s.solved() == SolveState::Solved);
+  EXPECT_EQ(1, bounds.size());
+  EXPECT_LE(s.statistics().suboptimality, config.weight);
+}
+
+TEST(solver, araStarBounds)
+{
+  const Map level = bundledLevel("level2");
+  Solver s;
+  s.setHeuristic(Heuristic::create(HeuristicType::HungarianTaxicab));
+  SolverConfig config;
+  config.algorithm = SearchAlgorithm::AraStar;
+  config.weight = 5;
+  config.weightStep = 0.5;
+  s.setConfig(config);
+  std::vector<double> bounds;
+  s.setSolutionCallback([&](const std::vector<Move> &, double bound) {
+    EXPECT_DOUBLE_EQ(bound, s.statistics().suboptimality);
+    bounds.push_back(bound);
+  });
+  s.solve(level);
+  ASSERT_TRUE(s.solved() == SolveState::Solved);
+  // several improving solutions
+  ASSERT_LT(1, bounds.size());
+  for (size_t i = 1; i < bounds.size(); ++i)
+  {
+    EXPECT_LE(bounds[i], bounds[i - 1]);
+  }
+  // the last search proves the solution optimal
+  EXPECT_DOUBLE_EQ(1., s.statistics().suboptimality);
+  EXPECT_EQ(aStarPushes(level), s.boxMovements());
+  EXPECT_TRUE(solves(level, s.result()));
+}
+
+TEST(solver, optimality)
+{
+  const size_t optimalMoves = minimalMoves(twoBoxLevel());
+  ASSERT_NE(g_inf, optimalMoves);
+
+  for (auto [type, lazy] : {std::pair(HeuristicType::HungarianTaxicab, false),
+                            std::pair(HeuristicType::HungarianTaxicab, true),
+                            std::pair(HeuristicType::HungarianPatternDatabase, false),
+                            std::pair(HeuristicType::HungarianPenalties, false),
+                            std::pair(HeuristicType::HungarianTaxicabPush, false)})
+  {
+    SolverConfig config;
+    config.lazyHeuristic = lazy;
+    // optimal modes ignore both of them
+    config.algorithm = SearchAlgorithm::IdaStar;
+    config.reopenNodes = false;
+
+    config.optimality = Optimality::Pushes;
+    auto s = solveWith(config, type);
+    ASSERT_TRUE(solvedWithMinimalPushes(*s));
+    EXPECT_LE(optimalMoves, s->result().size());
+
+    config.optimality = Optimality::Moves;
+    s = solveWith(config, type);
+    ASSERT_TRUE(s->solved() == SolveState::Solved);
+    EXPECT_EQ(optimalMoves, s->result().size());
+    EXPECT_LE(4, s->boxMovements());
+    EXPECT_LT(0, s->statistics().heuristicBytes);
+  }
+}
+
+TEST(solver, tunnelMacros)
+{
+  std::vector<std::vector<Cell>> rawM = {
+      {Cell::Field, Cell::Field, Cell::Wall, Cell::Wall, Cell::Wall, Cell::Wall},
+      {Cell::Unit, Cell::Box, Cell::Field, Cell::Field, Cell::Field, Cell::Destination},
+      {Cell::Field, Cell::Field, Cell::Wall, Cell::Wall, Cell::Wall, Cell::Wall}};
+  const std::vector<Move> expected(4, Move::Right);
+
+  SolverStatistics single;
+  for (bool macros : {false, true})
+  {
+    for (auto algorithm : {SearchAlgorithm::AStar, SearchAlgorithm::IdaStar})
+    {
+      Solver s;
+      s.setHeuristic(Heuristic::create(HeuristicType::HungarianTaxicab));
+      SolverConfig config;
+      config.algorithm = algorithm;
+      config.tunnelMacros = macros;
+      s.setConfig(config);
+      s.solve(Map(rawM));
+      ASSERT_TRUE(s.solved() == SolveState::Solved);
+      // macro is expanded back to single pushes
+      EXPECT_EQ(4, s.boxMovements());
+      EXPECT_EQ(expected, s.result());
+      if (algorithm != SearchAlgorithm::AStar)
+      {
+        continue;
+      }
+      if (!macros)
+      {
+        single = s.statistics();
+      }
+      else
+      {
+        // the box goes through the corridor in a single step
+        EXPECT_LT(s.statistics().nodes, single.nodes);
+        EXPECT_LT(s.statistics().heuristicCalls, single.heuristicCalls);
+      }
+    }
+  }
+}
+
+TEST(solver, greedyAndBeam)
+{
+  for (auto algorithm : {SearchAlgorithm::Greedy, SearchAlgorithm::Beam})
+  {
+    for (size_t width : {1, 2, 1000})
+    {
+      SolverConfig config;
+      config.algorithm = algorithm;
+      config.beamWidth = width;
+      auto s = solveWith(config);
+      ASSERT_TRUE(s->solved() == SolveState::Solved);
+      EXPECT_LE(4, s->boxMovements());
+      EXPECT_TRUE(solvesTwoBoxLevel(s->result()));
+      if (algorithm == SearchAlgorithm::Beam)
+      {
+        // a layer for each push
+        EXPECT_EQ(s->boxMovements(), s->statistics().iterations);
+      }
+    }
+  }
+
+  // no solution within the node limit
+  SolverConfig config;
+  config.algorithm = SearchAlgorithm::Beam;
+  config.maxNodes = 2;
+  EXPECT_TRUE(solveWith(config)->solved() == SolveState::NotSolved);
+}
+
+TEST(solver, externalAStar)
+{
+  std::vector<std::vector<Cell>> tunnelM = {
+      {Cell::Field, Cell::Field, Cell::Wall, Cell::Wall, Cell::Wall, Cell::Wall},
+      {Cell::Unit, Cell::Box, Cell::Field, Cell::Field, Cell::Field, Cell::Destination},
+      {Cell::Field, Cell::Field, Cell::Wall, Cell::Wall, Cell::Wall, Cell::Wall}};
+  const std::filesystem::path scratch =
+      std::filesystem::temp_directory_path() / "soko-test-external-astar";
+  std::filesystem::remove_all(scratch);
+
+  SolverConfig config;
+  config.algorithm = SearchAlgorithm::ExternalAStar;
+  config.scratchDirectory = scratch.string();
+  // a run per few records forces merges of several runs
+  for (size_t runBytes : {size_t(1), size_t(32), size_t(1) << 20})
+  {
+    config.runBytes = runBytes;
+    auto s = solveWith(config);
+    ASSERT_TRUE(solvedWithMinimalPushes(*s));
+    EXPECT_LT(0, s->statistics().scratchBytes);
+    EXPECT_TRUE(solvesTwoBoxLevel(s->result()));
+    // scratch files are removed
+    EXPECT_TRUE(std::filesystem::is_empty(scratch));
+
+    // parents of macro pushes are restored too
+    s->solve(Map(tunnelM));
+    ASSERT_TRUE(s->solved() == SolveState::Solved);
+    EXPECT_EQ(std::vector<Move>(4, Move::Right), s->result());
+  }
+
+  config.runBytes = SolverConfig().runBytes;
+  config.maxNodes = 2;
+  EXPECT_TRUE(solveWith(config)->solved() == SolveState::NotSolved);
+  std::filesystem::remove_all(scratch);
+}
+
+TEST(solver, externalAStarMerges)
+{
+  // buckets of the level get many duplicates, and a run holds a few records: the runs are
+  // merged with each other and with the closed file
+  const Map level = bundledLevel("level2");
+  const std::filesystem::path scratch =
+      std::filesystem::temp_directory_path() / "soko-test-external-astar-merges";
+  std::filesystem::remove_all(scratch);
+  {
+    Solver s;
+    s.setHeuristic(Heuristic::create(HeuristicType::HungarianTaxicab));
+    SolverConfig config;
+    config.algorithm = SearchAlgorithm::ExternalAStar;
+    config.scratchDirectory = scratch.string();
+    config.runBytes = 64;
+    s.setConfig(config);
+    s.solve(level);
+    ASSERT_TRUE(s.solved() == SolveState::Solved);
+    EXPECT_EQ(aStarPushes(level), s.boxMovements());
+    EXPECT_TRUE(solves(level, s.result()));
+  }
+  EXPECT_TRUE(std::filesystem::is_empty(scratch));
+  std::filesystem::remove_all(scratch);
 }
 
 } // namespace test
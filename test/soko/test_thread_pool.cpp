@@ -0,0 +1,37 @@
+#include <gtest/gtest.h>
+#include <atomic>
+#include "soko/thread_pool.h"
+
+namespace soko
+{
+
+namespace test
+{
+
+TEST(threadPool, runsEveryTask)
+{
+  for (size_t workers : {1, 2, 4})
+  {
+    ThreadPool pool(workers);
+    EXPECT_EQ(workers, pool.workers());
+    // pool is reused by successive batches, some of them are smaller than the pool
+    for (size_t count : {0, 1, 3, 100})
+    {
+      std::vector<std::atomic<size_t>> calls(count);
+      std::atomic<bool> wrongWorker{false};
+      pool.run(count, [&](size_t worker, size_t index) {
+        wrongWorker = wrongWorker || worker >= workers;
+        ++calls[index];
+      });
+      EXPECT_FALSE(wrongWorker);
+      for (auto &c : calls)
+      {
+        EXPECT_EQ(1, c);
+      }
+    }
+  }
+}
+
+} // namespace test
+
+} // namespace soko
@@ -0,0 +1,85 @@
+#include <gtest/gtest.h>
+#include "soko/transposition_table.hpp"
+
+namespace soko
+{
+
+namespace test
+{
+
+TEST(transpositionTable, findOrInsert)
+{
+  TranspositionTable<int> table(4);
+  auto create = [](int v) { return [v]() { return v; }; };
+  auto equal = [](int v) { return [v](int stored) { return stored == v; }; };
+
+  EXPECT_TRUE(table.findOrInsert(10, equal(1), create(1)).second);
+  // same hash, different value
+  EXPECT_TRUE(table.findOrInsert(10, equal(2), create(2)).second);
+  auto found = table.findOrInsert(10, equal(1), create(1));
+  EXPECT_FALSE(found.second);
+  EXPECT_EQ(1, *found.first);
+  // zero hash is reserved internally
+  EXPECT_TRUE(table.findOrInsert(0, equal(3), create(3)).second);
+  EXPECT_NE(nullptr, table.find(0, equal(3)));
+  EXPECT_EQ(nullptr, table.find(11, equal(1)));
+  EXPECT_EQ(3, table.size());
+}
+
+TEST(transpositionTable, growth)
+{
+  TranspositionTable<size_t> table(16, 0.5);
+  const size_t n = 1000;
+  for (size_t i = 0; i < n; ++i)
+  {
+    StateHash hash = i * 0x9E3779B97F4A7C15ULL;
+    ASSERT_TRUE(
+        table.findOrInsert(hash, [i](size_t v) { return v == i; }, [i]() { return i; }).second);
+  }
+  for (size_t i = 0; i < n; ++i)
+  {
+    StateHash hash = i * 0x9E3779B97F4A7C15ULL;
+    auto found = table.find(hash, [i](size_t v) { return v == i; });
+    ASSERT_NE(nullptr, found);
+    EXPECT_EQ(i, *found);
+  }
+
+  auto &stats = table.statistics();
+  EXPECT_EQ(n, stats.size);
+  EXPECT_EQ(2048, stats.capacity);
+  EXPECT_EQ(7, stats.resizes);
+  EXPECT_LE(stats.loadFactor(), 0.5);
+  EXPECT_EQ(2 * n, stats.lookups);
+  EXPECT_GE(stats.averageProbeLength(), 1.);
+  EXPECT_GE(stats.maxProbeLength, 1);
+}
+
+TEST(transpositionTable, bounded)
+{
+  // 16 bytes per slot: hash and value
+  BoundedTranspositionTable<uint64_t> table(100);
+  EXPECT_EQ(64, table.memoryUsage());
+  EXPECT_EQ(4, table.statistics().capacity);
+
+  table.store(1, 10);
+  table.store(2, 20);
+  ASSERT_NE(nullptr, table.find(1));
+  EXPECT_EQ(10, *table.find(1));
+  EXPECT_EQ(nullptr, table.find(3));
+  // same slot, the entry is replaced
+  table.store(5, 50);
+  EXPECT_EQ(nullptr, table.find(1));
+  EXPECT_EQ(50, *table.find(5));
+  table.store(5, 51);
+  EXPECT_EQ(51, *table.find(5));
+
+  auto &stats = table.statistics();
+  EXPECT_EQ(2, stats.size);
+  EXPECT_EQ(1, stats.replacements);
+  EXPECT_EQ(6, stats.lookups);
+  EXPECT_EQ(4, stats.hits);
+}
+
+} // namespace test
+
+} // namespace soko
@@ -0,0 +1,51 @@
+#include <gtest/gtest.h>
+#include "soko/tunnels.h"
+#include "soko/util.h"
+
+namespace soko
+{
+
+namespace test
+{
+
+TEST(tunnels, corridorCells)
+{
+  std::vector<std::vector<Cell>> rawM = {
+      {Cell::Field, Cell::Field, Cell::Wall, Cell::Wall, Cell::Wall, Cell::Wall, Cell::Field},
+      {Cell::Unit, Cell::Box, Cell::Field, Cell::Field, Cell::Destination, Cell::Field, Cell::Field},
+      {Cell::Field, Cell::Wall, Cell::Wall, Cell::Wall, Cell::Wall, Cell::Wall, Cell::Wall},
+      {Cell::Field, Cell::Wall, Cell::Wall, Cell::Wall, Cell::Wall, Cell::Wall, Cell::Wall}};
+  MapStatic m = mapToMapStatic(Map(rawM));
+  ASSERT_EQ(4, m.rows());
+  ASSERT_EQ(7, m.cols());
+
+  Tunnels tunnels(m);
+  EXPECT_FALSE(tunnels.empty());
+  auto tunnel = [&](Pos p, Move move) { return tunnels.isTunnel(toCellIndex(p, m.cols()), move); };
+  // horizontal corridor; destination isn't a tunnel cell
+  for (auto p : {Pos(1, 2), Pos(1, 3), Pos(1, 5)})
+  {
+    EXPECT_TRUE(tunnel(p, Move::Left));
+    EXPECT_TRUE(tunnel(p, Move::Right));
+    EXPECT_FALSE(tunnel(p, Move::Up));
+  }
+  EXPECT_FALSE(tunnel({1, 4}, Move::Right));
+  EXPECT_FALSE(tunnel({1, 1}, Move::Right));
+  EXPECT_FALSE(tunnel({1, 6}, Move::Right));
+  // vertical dead end along the map border
+  for (auto p : {Pos(2, 0), Pos(3, 0)})
+  {
+    EXPECT_TRUE(tunnel(p, Move::Down));
+    EXPECT_FALSE(tunnel(p, Move::Left));
+  }
+  EXPECT_FALSE(tunnel({1, 0}, Move::Down));
+  // walls aren't tunnels
+  EXPECT_FALSE(tunnel({0, 2}, Move::Left));
+
+  MapStatic open = mapToMapStatic(Map({{Cell::Unit, Cell::Field}, {Cell::Box, Cell::Destination}}));
+  EXPECT_TRUE(Tunnels(open).empty());
+}
+
+} // namespace test
+
+} // namespace soko